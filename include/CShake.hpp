@@ -0,0 +1,140 @@
+// cSHAKE customizable extendable-output functions.
+//
+// Copyright (c) 2026 Johannes Overmann
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <stdint.h>
+#include <span>
+#include <string_view>
+#include <vector>
+#include "KeccakSponge.hpp"
+
+/// cSHAKE128 and cSHAKE256 according to NIST SP 800-185 section 3.
+/// https://nvlpubs.nist.gov/nistpubs/SpecialPublications/NIST.SP.800-185.pdf
+/// Please use class CShake128 or CShake256 (see bottom of file).
+///
+/// The function name N and the customization string S are absorbed in the constructor (one block for short strings).
+/// With empty N and S cSHAKE is SHAKE. Copy a constructed object to reuse the absorbed prefix for many messages.
+/// The encoding functions (left_encode(), right_encode(), encode_string(), bytepad()) are public for the functions
+/// built on cSHAKE (KMAC, ParallelHash).
+template<size_t securityBits>
+class CShake
+{
+public:
+    /// Block size (rate) in bytes.
+    static constexpr size_t blockSize = 200 - securityBits / 4;
+
+    /// Absorb bytepad(encode_string(functionName) || encode_string(customization), blockSize).
+    CShake(std::string_view functionName = {}, std::span<const uint8_t> customization = {})
+    {
+        customized = !functionName.empty() || !customization.empty();
+        if (customized)
+        {
+            updateLeftEncoded(blockSize);
+            updateEncodedString(std::span<const uint8_t>(reinterpret_cast<const uint8_t *>(functionName.data()), functionName.size()));
+            updateEncodedString(customization);
+            padBlock();
+        }
+    }
+
+    /// Add data.
+    /// Must not be called after squeeze().
+    void update(const uint8_t *bytes, size_t n)
+    {
+        sponge.absorb(bytes, n);
+    }
+
+    /// Write the next output.size() output bytes to output.
+    /// The first call finishes the input. Subsequent calls continue the output stream.
+    void squeeze(std::span<uint8_t> output)
+    {
+        if (!sponge.isSqueezing())
+        {
+            sponge.pad(customized ? 0x04 : 0x1f);
+        }
+        sponge.squeeze(output.data(), output.size());
+    }
+
+    /// Add left_encode(x).
+    void updateLeftEncoded(uint64_t x)
+    {
+        uint8_t encoded[9];
+        unsigned n = numBytes(x);
+        encoded[0] = uint8_t(n);
+        storeBE(x, n, encoded + 1);
+        update(encoded, n + 1);
+    }
+
+    /// Add right_encode(x).
+    void updateRightEncoded(uint64_t x)
+    {
+        uint8_t encoded[9];
+        unsigned n = numBytes(x);
+        storeBE(x, n, encoded);
+        encoded[n] = uint8_t(n);
+        update(encoded, n + 1);
+    }
+
+    /// Add encode_string(s) (left_encode() of the bit length of s followed by s).
+    void updateEncodedString(std::span<const uint8_t> s)
+    {
+        updateLeftEncoded(uint64_t(s.size()) * 8);
+        update(s.data(), s.size());
+    }
+
+    /// Add zeros up to the end of the current block.
+    /// This completes bytepad(X, blockSize) if left_encode(blockSize) was added at the start of a block.
+    void padBlock()
+    {
+        static constexpr uint8_t zeros[blockSize] = {};
+        size_t pos = sponge.getBlockPos();
+        if (pos > 0)
+        {
+            update(zeros, blockSize - pos);
+        }
+    }
+
+private:
+    /// Number of bytes of the big-endian encoding of x (at least 1).
+    static unsigned numBytes(uint64_t x)
+    {
+        unsigned n = 1;
+        while ((n < 8) && (x >> (n * 8)))
+        {
+            n++;
+        }
+        return n;
+    }
+
+    /// Store the lower n bytes of x in big-endian byte order.
+    static void storeBE(uint64_t x, unsigned n, uint8_t *out)
+    {
+        for (unsigned i = 0; i < n; i++)
+        {
+            out[i] = uint8_t(x >> ((n - 1 - i) * 8));
+        }
+    }
+
+    /// Sponge with capacity 2 * securityBits.
+    KeccakSponge<blockSize> sponge;
+
+    /// N or S are not empty (domain separation 0x04 instead of 0x1f of SHAKE).
+    bool customized;
+};
+
+/// cSHAKE variants.
+class CShake128: public CShake<128>
+{
+public:
+    using CShake<128>::CShake;
+};
+
+class CShake256: public CShake<256>
+{
+public:
+    using CShake<256>::CShake;
+};
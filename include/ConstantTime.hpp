@@ -0,0 +1,34 @@
+// Constant time helpers.
+//
+// Copyright (c) 2026 Johannes Overmann
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <stdint.h>
+#include <cstddef>
+
+/// Compare n bytes without data dependent early exit (for comparing MACs).
+inline bool equalConstantTime(const uint8_t *a, const uint8_t *b, size_t n)
+{
+    // The volatile accumulator keeps the compiler from turning this into memcmp().
+    volatile uint8_t diff = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        diff = diff | (a[i] ^ b[i]);
+    }
+    return diff == 0;
+}
+
+/// Overwrite n bytes of secret data with zeros.
+/// Writes through a volatile pointer are not removed by the compiler, even if the memory is not read afterwards.
+inline void wipe(void *p, size_t n)
+{
+    volatile uint8_t *bytes = static_cast<volatile uint8_t *>(p);
+    for (size_t i = 0; i < n; i++)
+    {
+        bytes[i] = 0;
+    }
+}
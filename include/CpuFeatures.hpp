@@ -0,0 +1,140 @@
+// Runtime CPU feature detection for optional hardware accelerated code paths.
+//
+// Copyright (c) 2026 Johannes Overmann
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <stdint.h>
+#include <cstdlib>
+#include <cstring>
+
+// Hardware specific code paths are only available with GCC/Clang on x86.
+// Define LEANCRYPT_PORTABLE to only use the portable C++ implementations.
+#if !defined(LEANCRYPT_PORTABLE) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LEANCRYPT_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+// Force inlining of code which is shared between the portable and the target specific implementations,
+// so that it is compiled for the target of the caller.
+#ifdef __GNUC__
+#define LEANCRYPT_FORCE_INLINE __attribute__((always_inline)) inline
+#else
+#define LEANCRYPT_FORCE_INLINE inline
+#endif
+
+/// CPU features which are relevant for leancrypt.
+/// All features are false on non-x86 platforms.
+struct CpuFeatures
+{
+    bool ssse3 = false;
+    bool sse41 = false;
+    bool sha = false;
+    bool avx = false;
+    bool avx2 = false;
+    bool bmi2 = false;
+    bool avx512f = false;
+
+    /// Get features of the CPU we are running on.
+    /// The CPU is only queried on the first call.
+    ///
+    /// All hash classes select their code paths based on these features, so the environment variable
+    /// LEANCRYPT_ISA can be used to restrict them (e.g. to A/B test or to differentially test code paths):
+    /// - scalar: Only use the portable implementations.
+    /// - ssse3, avx, avx2, avx512: Use vector instructions up to the specified level, but no SHA extensions.
+    /// - shani: Use the SHA extensions (and SSE up to SSE4.1), but no AVX.
+    /// Features which the CPU does not support are never enabled. Other values are ignored.
+    static const CpuFeatures &get()
+    {
+        static const CpuFeatures features = restrictTo(detect(), std::getenv("LEANCRYPT_ISA"));
+        return features;
+    }
+
+    /// Restrict features to instruction set isa (see get()).
+    static CpuFeatures restrictTo(CpuFeatures features, const char *isa)
+    {
+        if (isa == nullptr)
+        {
+            return features;
+        }
+        CpuFeatures allowed;
+        if (strcmp(isa, "scalar") == 0)
+        {
+        }
+        else if (strcmp(isa, "ssse3") == 0)
+        {
+            allowed.ssse3 = true;
+        }
+        else if (strcmp(isa, "avx") == 0)
+        {
+            allowed.ssse3 = allowed.sse41 = allowed.avx = true;
+        }
+        else if (strcmp(isa, "avx2") == 0)
+        {
+            allowed.ssse3 = allowed.sse41 = allowed.avx = allowed.avx2 = allowed.bmi2 = true;
+        }
+        else if (strcmp(isa, "avx512") == 0)
+        {
+            allowed.ssse3 = allowed.sse41 = allowed.avx = allowed.avx2 = allowed.bmi2 = allowed.avx512f = true;
+        }
+        else if (strcmp(isa, "shani") == 0)
+        {
+            allowed.ssse3 = allowed.sse41 = allowed.sha = true;
+        }
+        else
+        {
+            return features;
+        }
+        features.ssse3 &= allowed.ssse3;
+        features.sse41 &= allowed.sse41;
+        features.sha &= allowed.sha;
+        features.avx &= allowed.avx;
+        features.avx2 &= allowed.avx2;
+        features.bmi2 &= allowed.bmi2;
+        features.avx512f &= allowed.avx512f;
+        return features;
+    }
+
+private:
+    /// Query CPU.
+    static CpuFeatures detect()
+    {
+        CpuFeatures features;
+#ifdef LEANCRYPT_X86
+        unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+        if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        {
+            return features;
+        }
+        features.ssse3 = (ecx >> 9) & 1;
+        features.sse41 = (ecx >> 19) & 1;
+
+        // The OS must save the YMM (and ZMM) registers on context switches.
+        uint64_t xcr0 = ((ecx >> 27) & 1) ? readXcr0() : 0; // OSXSAVE
+        bool osAvx = (xcr0 & 0x06) == 0x06;
+        bool osAvx512 = (xcr0 & 0xe6) == 0xe6;
+        features.avx = osAvx && ((ecx >> 28) & 1);
+
+        if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+        {
+            features.sha = (ebx >> 29) & 1;
+            features.avx2 = osAvx && ((ebx >> 5) & 1);
+            features.bmi2 = (ebx >> 8) & 1;
+            features.avx512f = osAvx512 && ((ebx >> 16) & 1);
+        }
+#endif
+        return features;
+    }
+
+#ifdef LEANCRYPT_X86
+    /// Read extended control register 0 (enabled register state components).
+    __attribute__((target("xsave"))) static uint64_t readXcr0()
+    {
+        return _xgetbv(0);
+    }
+#endif
+};
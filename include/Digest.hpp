@@ -0,0 +1,85 @@
+// Fixed size message digest value type.
+//
+// Copyright (c) 2026 Johannes Overmann
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <stdint.h>
+#include <array>
+#include <compare>
+#include <cstring>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include "Hex.hpp"
+
+/// Message digest (hash value) of N bytes.
+/// Trivially copyable, comparable and hashable, so it can directly be used as key in (unordered) maps.
+template<size_t N>
+struct Digest
+{
+    /// Digest bytes.
+    std::array<uint8_t, N> bytes;
+
+    /// Number of bytes.
+    static constexpr size_t size()
+    {
+        return N;
+    }
+
+    constexpr uint8_t *data()
+    {
+        return bytes.data();
+    }
+
+    constexpr const uint8_t *data() const
+    {
+        return bytes.data();
+    }
+
+    /// Write 2 * N lowercase hex digits to hex.
+    void toHex(char *hex) const
+    {
+        Hex::encode(bytes.data(), N, hex);
+    }
+
+    /// Get lowercase hex string.
+    std::string toHex() const
+    {
+        std::string r(N * 2, '\0');
+        toHex(r.data());
+        return r;
+    }
+
+    /// Parse 2 * N hex digits.
+    /// Return std::nullopt if hex has the wrong length or contains other characters.
+    static std::optional<Digest> fromHex(std::string_view hex)
+    {
+        Digest r;
+        if ((hex.size() != N * 2) || !Hex::decode(hex.data(), N, r.bytes.data()))
+        {
+            return std::nullopt;
+        }
+        return r;
+    }
+
+    bool operator==(const Digest &other) const = default;
+    auto operator<=>(const Digest &other) const = default;
+};
+
+/// Hash of a digest for unordered containers.
+/// Digests are uniformly distributed already, so just use the first 8 bytes.
+template<size_t N>
+struct std::hash<Digest<N>>
+{
+    size_t operator()(const Digest<N> &digest) const noexcept
+    {
+        uint64_t r = 0;
+        memcpy(&r, digest.bytes.data(), N < 8 ? N : 8);
+        return size_t(r);
+    }
+};
@@ -0,0 +1,60 @@
+// Scatter-gather input for the block based hashes.
+//
+// Copyright (c) 2026 Johannes Overmann
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <span>
+
+/// Add the concatenation of fragments (e.g. from readv()) to the chaining state of a block based hash (MD5, SHA-1, SHA-2).
+///
+/// The fragments are walked once with a single cursor through the current block: Runs of whole blocks inside a fragment
+/// are compressed in place with one HashClass::compressBlocks() call, only blocks spanning fragment boundaries are
+/// assembled in buffer (blockSize bytes, bufferedBytes of them already used by the hasher). Afterwards buffer holds the
+/// trailing partial block. Return the number of bytes added, so the caller updates its message length once.
+template<class HashClass>
+size_t updateFragments(typename HashClass::Word *state, uint8_t *buffer, size_t bufferedBytes, std::span<const std::span<const uint8_t>> fragments)
+{
+    constexpr size_t blockSize = HashClass::blockSize;
+    size_t total = 0;
+    for (std::span<const uint8_t> fragment: fragments)
+    {
+        const uint8_t *bytes = fragment.data();
+        size_t n = fragment.size();
+        total += n;
+
+        // Continue the block spanning the previous fragment boundary.
+        if (bufferedBytes > 0)
+        {
+            size_t num = std::min(n, blockSize - bufferedBytes);
+            std::copy(bytes, bytes + num, buffer + bufferedBytes);
+            bufferedBytes += num;
+            bytes += num;
+            n -= num;
+            if (bufferedBytes < blockSize)
+            {
+                continue;
+            }
+            HashClass::compressBlocks(state, buffer, 1);
+            bufferedBytes = 0;
+        }
+
+        size_t numBlocks = n / blockSize;
+        if (numBlocks > 0)
+        {
+            HashClass::compressBlocks(state, bytes, numBlocks);
+            bytes += numBlocks * blockSize;
+            n -= numBlocks * blockSize;
+        }
+
+        // Start the block spanning the next fragment boundary.
+        std::copy(bytes, bytes + n, buffer);
+        bufferedBytes = n;
+    }
+    return total;
+}
@@ -8,16 +8,38 @@
 #pragma once
 
 #include <vector>
+#include <array>
+#include <span>
 #include <string>
+#include <string_view>
+#include <cassert>
 #include <stdint.h>
+#include "Digest.hpp"
+
+/// Write hash of bytes to hash (HASH::hashSize bytes).
+/// Uses the one-shot HASH::calcHash() if HASH supports it (no buffering, a single compression for short messages).
+template <class HASH>
+constexpr void calcHashInto(const uint8_t *bytes, size_t n, uint8_t *hash)
+{
+    if constexpr (requires { HASH::calcHash(bytes, n, hash); })
+    {
+        HASH::calcHash(bytes, n, hash);
+    }
+    else
+    {
+        HASH hasher;
+        hasher.update(bytes, n);
+        hasher.finalize(std::span<uint8_t>(hash, HASH::hashSize));
+    }
+}
 
 /// Get hash of bytes.
 template <class HASH>
 std::vector<uint8_t> calcHash(const uint8_t *bytes, size_t n)
 {
-    HASH hasher;
-    hasher.update(bytes, n);
-    return hasher.finalize();
+    std::vector<uint8_t> r(HASH::hashSize);
+    calcHashInto<HASH>(bytes, n, r.data());
+    return r;
 }
 
 /// Get hash of string.
@@ -34,6 +56,104 @@ std::vector<uint8_t> calcHash(const std::vector<uint8_t> &bytes)
     return calcHash<HASH>(bytes.data(), bytes.size());
 }
 
+/// Write hash of bytes to hash (room for at least HASH::hashSize bytes).
+/// Does not allocate memory.
+template <class HASH>
+void calcHash(const uint8_t *bytes, size_t n, std::span<uint8_t> hash)
+{
+    assert(hash.size() >= HASH::hashSize);
+    calcHashInto<HASH>(bytes, n, hash.data());
+}
+
+/// Get hash of the concatenation of several buffers (scatter-gather input, e.g. from readv()).
+template <class HASH>
+std::vector<uint8_t> calcHash(std::span<const std::span<const uint8_t>> fragments)
+{
+    if (fragments.size() == 1)
+    {
+        return calcHash<HASH>(fragments[0].data(), fragments[0].size());
+    }
+    HASH hasher;
+    hasher.updatev(fragments);
+    return hasher.finalize();
+}
+
+/// Get hash of bytes without allocating memory.
+template <class HASH>
+constexpr std::array<uint8_t, HASH::hashSize> calcHashArray(const uint8_t *bytes, size_t n)
+{
+    std::array<uint8_t, HASH::hashSize> r;
+    calcHashInto<HASH>(bytes, n, r.data());
+    return r;
+}
+
+/// Get hash of bytes without allocating memory.
+template <class HASH>
+constexpr std::array<uint8_t, HASH::hashSize> calcHashArray(std::span<const uint8_t> bytes)
+{
+    return calcHashArray<HASH>(bytes.data(), bytes.size());
+}
+
+/// Get hash of bytes as Digest.
+template <class HASH>
+constexpr Digest<HASH::hashSize> calcDigest(const uint8_t *bytes, size_t n)
+{
+    return Digest<HASH::hashSize>{calcHashArray<HASH>(bytes, n)};
+}
+
+/// Get hash of bytes as Digest.
+template <class HASH>
+constexpr Digest<HASH::hashSize> calcDigest(std::span<const uint8_t> bytes)
+{
+    return calcDigest<HASH>(bytes.data(), bytes.size());
+}
+
+/// Get hash of string as Digest.
+/// Can be evaluated at compile time, e.g. constexpr auto key = calcDigest<HashSha256>("name").
+template <class HASH>
+constexpr Digest<HASH::hashSize> calcDigest(std::string_view s)
+{
+    if consteval
+    {
+        std::vector<uint8_t> bytes(s.begin(), s.end());
+        return calcDigest<HASH>(bytes.data(), bytes.size());
+    }
+    return calcDigest<HASH>(reinterpret_cast<const uint8_t *>(s.data()), s.size());
+}
+
+/// Get hashes of many independent messages.
+/// Uses multi-buffer hashing (several messages in parallel in SIMD lanes) if HASH supports it.
+template <class HASH>
+std::vector<std::vector<uint8_t>> calcHashes(const std::vector<std::vector<uint8_t>> &messages)
+{
+    std::vector<std::vector<uint8_t>> r;
+    r.reserve(messages.size());
+    if constexpr (requires { HASH::calcHashes(nullptr, nullptr, 0, nullptr); })
+    {
+        std::vector<const uint8_t *> pointers;
+        std::vector<size_t> lengths;
+        for (const std::vector<uint8_t> &message: messages)
+        {
+            pointers.push_back(message.data());
+            lengths.push_back(message.size());
+        }
+        std::vector<uint8_t> hashes(messages.size() * HASH::hashSize);
+        HASH::calcHashes(pointers.data(), lengths.data(), messages.size(), hashes.data());
+        for (size_t i = 0; i < messages.size(); i++)
+        {
+            r.emplace_back(hashes.begin() + i * HASH::hashSize, hashes.begin() + (i + 1) * HASH::hashSize);
+        }
+    }
+    else
+    {
+        for (const std::vector<uint8_t> &message: messages)
+        {
+            r.push_back(calcHash<HASH>(message));
+        }
+    }
+    return r;
+}
+
 /// Add string to hash.
 template<class HashClass>
 void updateHash(HashClass &hasher, const std::string &s)
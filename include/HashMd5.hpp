@@ -9,15 +9,28 @@
 
 #include <stdint.h>
 #include <vector>
+#include <array>
+#include <span>
+#include <cassert>
 #include <algorithm>
 #include <bit>
 #include <cstring>
+#include "CpuFeatures.hpp"
+#include "Fragments.hpp"
+#include "Midstate.hpp"
+#include "MultiBuffer.hpp"
 
 /// MD5 implementation according to RFC1321.
 /// https://datatracker.ietf.org/doc/html/rfc1321
 class HashMd5
 {
 public:
+    /// Hash size in bytes.
+    static constexpr size_t hashSize = 16;
+
+    /// Block size in bytes.
+    static constexpr size_t blockSize = 64;
+
     HashMd5()
     {
         clear();
@@ -58,37 +71,168 @@ public:
         messageLength += n;
     }
 
+    /// Add data from several buffers (scatter-gather input) in one pass, see updateFragments().
+    void updatev(std::span<const std::span<const uint8_t>> fragments)
+    {
+        messageLength += updateFragments<HashMd5>(state, buffer, messageLength % blockSize, fragments);
+    }
+
     /// Get hash.
     std::vector<uint8_t> finalize()
     {
-        // Pad message and calc final 1-2 blocks.
+        std::vector<uint8_t> r(hashSize);
+        finalizeInto(r.data());
+        return r;
+    }
+
+    /// Write hash to hash (room for at least hashSize bytes).
+    /// Does not allocate memory.
+    void finalize(std::span<uint8_t> hash)
+    {
+        assert(hash.size() >= hashSize);
+        finalizeInto(hash.data());
+    }
+
+    /// Get hash without allocating memory.
+    std::array<uint8_t, hashSize> finalizeArray()
+    {
+        std::array<uint8_t, hashSize> r;
+        finalizeInto(r.data());
+        return r;
+    }
+
+    /// Export the hasher state (chaining state, buffered bytes and message length) as versioned blob (see Midstate.hpp).
+    /// Use importState() to continue hashing later, for example to hash a common prefix only once.
+    std::vector<uint8_t> exportState() const
+    {
+        return Midstate::store(Midstate::Algorithm::md5, hashSize, messageLength, state, 4, buffer, messageLength & 0x3f);
+    }
+
+    /// Import a state exported by exportState().
+    /// Return false and leave the hasher unchanged if blob is not a valid MD5 state.
+    bool importState(std::span<const uint8_t> blob)
+    {
+        uint32_t s[4];
+        uint64_t length;
+        std::span<const uint8_t> buffered;
+        if (!Midstate::load(blob, Midstate::Algorithm::md5, hashSize, length, s, 4, buffered) || (buffered.size() != (length & 0x3f)))
+        {
+            return false;
+        }
+        std::copy(s, s + 4, state);
+        std::copy(buffered.begin(), buffered.end(), buffer);
+        messageLength = length;
+        return true;
+    }
+
+    /// Calculate the hash of n bytes in one go and write it to hash (hashSize bytes).
+    /// Can be used in constant expressions.
+    /// Faster than update() and finalize() for short messages: There is no buffering and messages of up to 55 bytes need exactly one compression.
+    static constexpr void calcHash(const uint8_t *bytes, size_t n, uint8_t *hash)
+    {
+        uint32_t s[4];
+        std::copy(initialState, initialState + 4, s);
+        size_t numBlocks = n / 64;
+        processBlocks(s, bytes, numBlocks);
+
+        // Pad the remaining bytes on the stack.
+        alignas(8) uint8_t block[128];
+        std::copy(bytes + numBlocks * 64, bytes + n, block);
+        processBlocks(s, block, padMessage(block, n));
+        storeHash(s, hash);
+    }
+
+    /// Calculate the hashes of count independent messages (multi-buffer hashing).
+    /// The hash of messages[i] (lengths[i] bytes) is written to hashes + i * hashSize.
+    /// On CPUs with AVX2/AVX-512 8/16 messages are hashed in parallel in the lanes of the SIMD registers.
+    static void calcHashes(const uint8_t *const *messages, const size_t *lengths, size_t count, uint8_t *hashes)
+    {
+#ifdef LEANCRYPT_X86
+        const CpuFeatures &cpu = CpuFeatures::get();
+        if (cpu.avx512f)
+        {
+            multiBufferHash<MultiBufferTraits, 16>(processBlockLanesAvx512, messages, lengths, count, hashes);
+            return;
+        }
+        if (cpu.avx2)
+        {
+            multiBufferHash<MultiBufferTraits, 8>(processBlockLanesAvx2, messages, lengths, count, hashes);
+            return;
+        }
+#endif
+        for (size_t i = 0; i < count; i++)
+        {
+            calcHash(messages[i], lengths[i], hashes + i * hashSize);
+        }
+    }
+
+    /// Compression function interface (PBKDF2 iterates it directly on the HMAC key states).
+    /// The chaining state consists of stateWords words of type Word.
+    using Word = uint32_t;
+    static constexpr size_t stateWords = 4;
+
+    /// Copy the chaining state (stateWords words) to s.
+    /// Only valid at block boundaries, e.g. after the key block of HMAC.
+    void getChainingState(Word *s) const
+    {
+        assert(messageLength % blockSize == 0);
+        std::copy(state, state + stateWords, s);
+    }
+
+    /// Compress numBlocks whole blocks of data into the chaining state s.
+    static constexpr void compressBlocks(Word *s, const uint8_t *data, size_t numBlocks)
+    {
+        processBlocks(s, data, numBlocks);
+    }
+
+    /// Pad the last (messageLength % 64) message bytes in block (room for two blocks).
+    /// Return the number of blocks to process (1 or 2).
+    static constexpr size_t padMessage(uint8_t *block, size_t messageLength)
+    {
         size_t bufferedBytes = messageLength & 0x3f;
-        buffer[bufferedBytes] = 0x80;
-        memset(buffer + bufferedBytes + 1, 0, 64 - bufferedBytes - 1);
-        if (bufferedBytes + 9 > 64)
+        size_t numBlocks = (bufferedBytes + 9 > 64) ? 2 : 1;
+        block[bufferedBytes] = 0x80;
+        std::fill(block + bufferedBytes + 1, block + numBlocks * 64 - 8, 0);
+        // Message length in bits as little-endian 64-bit number.
+        uint64_t bitLength = uint64_t(messageLength) << 3;
+        for (unsigned i = 0; i < 8; i++)
         {
-            processBlock(buffer);
-            memset(buffer, 0, 64 - 8);
+            block[numBlocks * 64 - 8 + i] = uint8_t(bitLength >> (i * 8));
         }
-        uint32_t *buffer32 = reinterpret_cast<uint32_t *>(buffer);
-        buffer32[14] = byteSwap32BE(messageLength << 3);
-        buffer32[15] = byteSwap32BE(messageLength >> 29);
-        processBlock(buffer);
-
-        // Return hash.
-        std::vector<uint8_t> r(16);
-        uint32_t *data = reinterpret_cast<uint32_t *>(r.data());
+        return numBlocks;
+    }
+
+    /// Store state as little-endian hash.
+    static constexpr void storeHash(const uint32_t *state, uint8_t *hash)
+    {
         for (unsigned i = 0; i < 4; i++)
         {
-            *(data++) = byteSwap32BE(state[i]);
+            hash[i * 4 + 0] = uint8_t(state[i]);
+            hash[i * 4 + 1] = uint8_t(state[i] >> 8);
+            hash[i * 4 + 2] = uint8_t(state[i] >> 16);
+            hash[i * 4 + 3] = uint8_t(state[i] >> 24);
         }
-        clear();
-        return r;
     }
 
 private:
+    /// Write hash to hash (hashSize bytes) and clear hasher.
+    void finalizeInto(uint8_t *hash)
+    {
+        // Pad message and calc final 1-2 blocks.
+        alignas(8) uint8_t block[128];
+        std::copy(buffer, buffer + (messageLength & 0x3f), block);
+        size_t numBlocks = padMessage(block, messageLength);
+        for (size_t i = 0; i < numBlocks; i++)
+        {
+            processBlock(block + i * 64);
+        }
+
+        storeHash(state, hash);
+        clear();
+    }
+
     /// Reverse bytes in 32-bit word on big-endian machines.
-    int32_t byteSwap32BE(uint32_t x)
+    static uint32_t byteSwap32BE(uint32_t x)
     {
 #ifdef __BIG_ENDIAN__
         x = ((x & 0x0000ffff) << 16) | ((x & 0xffff0000) >> 16);
@@ -99,20 +243,51 @@ private:
     }
 
     /// Helper functions.
-    static void f(uint32_t &a, uint32_t b, uint32_t c, uint32_t d, uint32_t x, uint32_t s, uint32_t ac) { a += ((b & c) | ((~b) & d)) + x + ac; a = std::rotl(a, s); a += b; }
-    static void g(uint32_t &a, uint32_t b, uint32_t c, uint32_t d, uint32_t x, uint32_t s, uint32_t ac) { a += ((b & d) | (c & (~d))) + x + ac; a = std::rotl(a, s); a += b; }
-    static void h(uint32_t &a, uint32_t b, uint32_t c, uint32_t d, uint32_t x, uint32_t s, uint32_t ac) { a += (b ^ c ^ d)            + x + ac; a = std::rotl(a, s); a += b; }
-    static void i(uint32_t &a, uint32_t b, uint32_t c, uint32_t d, uint32_t x, uint32_t s, uint32_t ac) { a += (c ^ (b | (~d)))       + x + ac; a = std::rotl(a, s); a += b; }
+    /// T is either uint32_t or a SIMD vector of uint32_t (multi-buffer implementation), so arguments are passed by reference.
+    template<class T> static constexpr void rotl(T &a, uint32_t s) { a = (a << s) | (a >> (32 - s)); }
+    template<class T> static constexpr void f(T &a, const T &b, const T &c, const T &d, const T &x, uint32_t s, uint32_t ac) { a += ((b & c) | ((~b) & d)) + x + ac; rotl(a, s); a += b; }
+    template<class T> static constexpr void g(T &a, const T &b, const T &c, const T &d, const T &x, uint32_t s, uint32_t ac) { a += ((b & d) | (c & (~d))) + x + ac; rotl(a, s); a += b; }
+    template<class T> static constexpr void h(T &a, const T &b, const T &c, const T &d, const T &x, uint32_t s, uint32_t ac) { a += (b ^ c ^ d)            + x + ac; rotl(a, s); a += b; }
+    template<class T> static constexpr void i(T &a, const T &b, const T &c, const T &d, const T &x, uint32_t s, uint32_t ac) { a += (c ^ (b | (~d)))       + x + ac; rotl(a, s); a += b; }
 
     /// Process block.
     void processBlock(const uint8_t *data8)
     {
-        uint32_t a = state[0];
-        uint32_t b = state[1];
-        uint32_t c = state[2];
-        uint32_t d = state[3];
+        processBlocks(state, data8, 1);
+    }
+
+    /// Process whole blocks.
+    /// Assembles the little-endian words byte by byte during constant evaluation.
+    static constexpr void processBlocks(uint32_t *state, const uint8_t *data8, size_t numBlocks)
+    {
+        for (size_t i = 0; i < numBlocks; i++)
+        {
+            if consteval
+            {
+                uint32_t data[16];
+                for (unsigned t = 0; t < 16; t++)
+                {
+                    const uint8_t *p = data8 + i * 64 + t * 4;
+                    data[t] = uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+                }
+                processBlockWords(state, data);
+            }
+            else
+            {
+                processBlockWords(state, reinterpret_cast<const uint32_t*>(data8 + i * 64));
+            }
+        }
+    }
 
-        const uint32_t *data = reinterpret_cast<const uint32_t*>(data8);
+    /// Process block of 16 words.
+    /// T is either uint32_t or a SIMD vector of uint32_t (multi-buffer implementation).
+    template<class T>
+    static constexpr LEANCRYPT_FORCE_INLINE void processBlockWords(T *state, const T *data)
+    {
+        T a = state[0];
+        T b = state[1];
+        T c = state[2];
+        T d = state[3];
 
         // 4 * 16 = 64 unrolled rounds.
         f(a, b, c, d, data[ 0],  7, 0xd76aa478);
@@ -186,6 +361,41 @@ private:
         state[3] += d;
     }
 
+#ifdef LEANCRYPT_X86
+    /// Process one block in each SIMD lane of V (multi-buffer implementation).
+    /// state is stored word-major: state[word * numLanes + lane].
+    /// Only pass vectors by pointer here: This is inlined into the target specific functions below.
+    template<class V>
+    __attribute__((always_inline)) static inline void processBlockLanes(uint32_t *state, const uint8_t *const *blocks)
+    {
+        constexpr unsigned numLanes = sizeof(V) / sizeof(uint32_t);
+        V s[4];
+        memcpy(s, state, sizeof(s));
+        V data[16];
+        for (unsigned t = 0; t < 16; t++)
+        {
+            for (unsigned lane = 0; lane < numLanes; lane++)
+            {
+                data[t][lane] = byteSwap32BE(*reinterpret_cast<const uint32_t *>(blocks[lane] + t * 4));
+            }
+        }
+        processBlockWords(s, data);
+        memcpy(state, s, sizeof(s));
+    }
+
+    /// Process 8 blocks in parallel using AVX2.
+    __attribute__((target("avx2"))) static void processBlockLanesAvx2(uint32_t *state, const uint8_t *const *blocks)
+    {
+        processBlockLanes<MultiBufferU32x8>(state, blocks);
+    }
+
+    /// Process 16 blocks in parallel using AVX-512.
+    __attribute__((target("avx512f"))) static void processBlockLanesAvx512(uint32_t *state, const uint8_t *const *blocks)
+    {
+        processBlockLanes<MultiBufferU32x16>(state, blocks);
+    }
+#endif
+
     /// Initial state.
     static constexpr uint32_t initialState[4] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
 
@@ -197,4 +407,16 @@ private:
 
     /// Message length in bytes.
     size_t messageLength;
+
+    /// Interface for multiBufferHash().
+    struct MultiBufferTraits
+    {
+        using Word = HashMd5::Word;
+        static constexpr size_t blockSize = HashMd5::blockSize;
+        static constexpr size_t stateWords = HashMd5::stateWords;
+        static constexpr size_t hashSize = HashMd5::hashSize;
+        static constexpr const uint32_t *initialState = HashMd5::initialState;
+        static size_t padMessage(uint8_t *block, size_t messageLength) { return HashMd5::padMessage(block, messageLength); }
+        static void storeHash(const uint32_t *state, uint8_t *hash) { HashMd5::storeHash(state, hash); }
+    };
 };
@@ -9,15 +9,28 @@
 
 #include <stdint.h>
 #include <vector>
+#include <array>
+#include <span>
+#include <cassert>
 #include <algorithm>
 #include <bit>
 #include <cstring>
+#include "CpuFeatures.hpp"
+#include "Fragments.hpp"
+#include "Midstate.hpp"
+#include "MultiBuffer.hpp"
 
 /// SHA-1 implementation according to FIPS PUB 180-4.
 /// https://nvlpubs.nist.gov/nistpubs/FIPS/NIST.FIPS.180-4.pdf
 class HashSha1
 {
 public:
+    /// Hash size in bytes.
+    static constexpr size_t hashSize = 20;
+
+    /// Block size in bytes.
+    static constexpr size_t blockSize = 64;
+
     HashSha1()
     {
         clear();
@@ -48,47 +61,175 @@ public:
         }
 
         // Process whole blocks of input.
-        for (; n >= 64; bytes += 64, messageLength += 64, n -= 64)
-        {
-            processBlock(bytes);
-        }
+        size_t numBlocks = n / 64;
+        processBlocks(bytes, numBlocks);
+        bytes += numBlocks * 64;
+        messageLength += numBlocks * 64;
+        n -= numBlocks * 64;
 
         // Put remaining bytes into buffer.
         std::copy(bytes, bytes + n, buffer + bufferedBytes);
         messageLength += n;
     }
 
+    /// Add data from several buffers (scatter-gather input) in one pass, see updateFragments().
+    void updatev(std::span<const std::span<const uint8_t>> fragments)
+    {
+        messageLength += updateFragments<HashSha1>(state, buffer, messageLength % blockSize, fragments);
+    }
+
     /// Get hash.
     std::vector<uint8_t> finalize()
     {
-        // Pad message and calc final 1-2 blocks.
+        std::vector<uint8_t> r(hashSize);
+        finalizeInto(r.data());
+        return r;
+    }
+
+    /// Write hash to hash (room for at least hashSize bytes).
+    /// Does not allocate memory.
+    void finalize(std::span<uint8_t> hash)
+    {
+        assert(hash.size() >= hashSize);
+        finalizeInto(hash.data());
+    }
+
+    /// Get hash without allocating memory.
+    std::array<uint8_t, hashSize> finalizeArray()
+    {
+        std::array<uint8_t, hashSize> r;
+        finalizeInto(r.data());
+        return r;
+    }
+
+    /// Export the hasher state (chaining state, buffered bytes and message length) as versioned blob (see Midstate.hpp).
+    /// Use importState() to continue hashing later, for example to hash a common prefix only once.
+    std::vector<uint8_t> exportState() const
+    {
+        return Midstate::store(Midstate::Algorithm::sha1, hashSize, messageLength, state, 5, buffer, messageLength & 0x3f);
+    }
+
+    /// Import a state exported by exportState().
+    /// Return false and leave the hasher unchanged if blob is not a valid SHA-1 state.
+    bool importState(std::span<const uint8_t> blob)
+    {
+        uint32_t s[5];
+        uint64_t length;
+        std::span<const uint8_t> buffered;
+        if (!Midstate::load(blob, Midstate::Algorithm::sha1, hashSize, length, s, 5, buffered) || (buffered.size() != (length & 0x3f)))
+        {
+            return false;
+        }
+        std::copy(s, s + 5, state);
+        std::copy(buffered.begin(), buffered.end(), buffer);
+        messageLength = length;
+        return true;
+    }
+
+    /// Calculate the hash of n bytes in one go and write it to hash (hashSize bytes).
+    /// Can be used in constant expressions.
+    /// Faster than update() and finalize() for short messages: There is no buffering and messages of up to 55 bytes need exactly one compression.
+    static constexpr void calcHash(const uint8_t *bytes, size_t n, uint8_t *hash)
+    {
+        uint32_t s[5];
+        std::copy(initialState, initialState + 5, s);
+        size_t numBlocks = n / 64;
+        processBlocks(s, bytes, numBlocks);
+
+        // Pad the remaining bytes on the stack.
+        alignas(8) uint8_t block[128];
+        std::copy(bytes + numBlocks * 64, bytes + n, block);
+        processBlocks(s, block, padMessage(block, n));
+        storeHash(s, hash);
+    }
+
+    /// Calculate the hashes of count independent messages (multi-buffer hashing).
+    /// The hash of messages[i] (lengths[i] bytes) is written to hashes + i * hashSize.
+    /// On CPUs with AVX2/AVX-512 8/16 messages are hashed in parallel in the lanes of the SIMD registers.
+    static void calcHashes(const uint8_t *const *messages, const size_t *lengths, size_t count, uint8_t *hashes)
+    {
+#ifdef LEANCRYPT_X86
+        const CpuFeatures &cpu = CpuFeatures::get();
+        if (cpu.avx512f)
+        {
+            multiBufferHash<MultiBufferTraits, 16>(processBlockLanesAvx512, messages, lengths, count, hashes);
+            return;
+        }
+        if (cpu.avx2 && !cpu.sha)
+        {
+            multiBufferHash<MultiBufferTraits, 8>(processBlockLanesAvx2, messages, lengths, count, hashes);
+            return;
+        }
+#endif
+        for (size_t i = 0; i < count; i++)
+        {
+            calcHash(messages[i], lengths[i], hashes + i * hashSize);
+        }
+    }
+
+    /// Compression function interface (PBKDF2 iterates it directly on the HMAC key states).
+    /// The chaining state consists of stateWords words of type Word.
+    using Word = uint32_t;
+    static constexpr size_t stateWords = 5;
+
+    /// Copy the chaining state (stateWords words) to s.
+    /// Only valid at block boundaries, e.g. after the key block of HMAC.
+    void getChainingState(Word *s) const
+    {
+        assert(messageLength % blockSize == 0);
+        std::copy(state, state + stateWords, s);
+    }
+
+    /// Compress numBlocks whole blocks of data into the chaining state s.
+    static constexpr void compressBlocks(Word *s, const uint8_t *data, size_t numBlocks)
+    {
+        processBlocks(s, data, numBlocks);
+    }
+
+    /// Pad the last (messageLength % 64) message bytes in block (room for two blocks).
+    /// Return the number of blocks to process (1 or 2).
+    static constexpr size_t padMessage(uint8_t *block, size_t messageLength)
+    {
         size_t bufferedBytes = messageLength & 0x3f;
-        buffer[bufferedBytes] = 0x80;
-        memset(buffer + bufferedBytes + 1, 0, 64 - bufferedBytes - 1);
-        if (bufferedBytes + 9 > 64)
+        size_t numBlocks = (bufferedBytes + 9 > 64) ? 2 : 1;
+        block[bufferedBytes] = 0x80;
+        std::fill(block + bufferedBytes + 1, block + numBlocks * 64 - 8, 0);
+        // Message length in bits as big-endian 64-bit number.
+        uint64_t bitLength = uint64_t(messageLength) << 3;
+        for (unsigned i = 0; i < 8; i++)
         {
-            processBlock(buffer);
-            memset(buffer, 0, 64 - 8);
+            block[numBlocks * 64 - 1 - i] = uint8_t(bitLength >> (i * 8));
         }
-        uint32_t *buffer32 = reinterpret_cast<uint32_t *>(buffer);
-        buffer32[14] = byteSwap32LE(messageLength >> 29);
-        buffer32[15] = byteSwap32LE(messageLength << 3);
-        processBlock(buffer);
+        return numBlocks;
+    }
 
-        // Return hash.
-        std::vector<uint8_t> r(20);
-        uint32_t *data = reinterpret_cast<uint32_t *>(r.data());
+    /// Store state as big-endian hash.
+    static constexpr void storeHash(const uint32_t *state, uint8_t *hash)
+    {
         for (unsigned i = 0; i < 5; i++)
         {
-            *(data++) = byteSwap32LE(state[i]);
+            hash[i * 4 + 0] = uint8_t(state[i] >> 24);
+            hash[i * 4 + 1] = uint8_t(state[i] >> 16);
+            hash[i * 4 + 2] = uint8_t(state[i] >> 8);
+            hash[i * 4 + 3] = uint8_t(state[i]);
         }
-        clear();
-        return r;
     }
 
 private:
+    /// Write hash to hash (hashSize bytes) and clear hasher.
+    void finalizeInto(uint8_t *hash)
+    {
+        // Pad message and calc final 1-2 blocks.
+        alignas(8) uint8_t block[128];
+        std::copy(buffer, buffer + (messageLength & 0x3f), block);
+        processBlocks(block, padMessage(block, messageLength));
+
+        storeHash(state, hash);
+        clear();
+    }
+
     /// Reverse bytes in 32-bit word on little-endian machines.
-    uint32_t byteSwap32LE(uint32_t x)
+    static constexpr uint32_t byteSwap32LE(uint32_t x)
     {
 #ifdef __BIG_ENDIAN__
         return x;
@@ -98,13 +239,69 @@ private:
 #endif
     }
 
+    /// Load big-endian 32-bit word.
+    static constexpr uint32_t loadBE32(const uint8_t *data)
+    {
+        if consteval
+        {
+            return (uint32_t(data[0]) << 24) | (uint32_t(data[1]) << 16) | (uint32_t(data[2]) << 8) | data[3];
+        }
+        return byteSwap32LE(*reinterpret_cast<const uint32_t *>(data));
+    }
+
     /// Helper functions.
-    static uint32_t Ch(uint32_t x, uint32_t y, uint32_t z) { return (x & y) ^ ((~x) & z); }
-    static uint32_t Maj(uint32_t x, uint32_t y, uint32_t z) { return (x & y) ^ (x & z) ^ (y & z); }
-    static uint32_t Par(uint32_t x, uint32_t y, uint32_t z) { return x ^ y ^ z; }
+    static constexpr uint32_t Ch(uint32_t x, uint32_t y, uint32_t z) { return (x & y) ^ ((~x) & z); }
+    static constexpr uint32_t Maj(uint32_t x, uint32_t y, uint32_t z) { return (x & y) ^ (x & z) ^ (y & z); }
+    static constexpr uint32_t Par(uint32_t x, uint32_t y, uint32_t z) { return x ^ y ^ z; }
 
     /// Process block.
     void processBlock(const uint8_t *data)
+    {
+        processBlocks(data, 1);
+    }
+
+    /// Process whole blocks.
+    void processBlocks(const uint8_t *data, size_t numBlocks)
+    {
+        processBlocks(state, data, numBlocks);
+    }
+
+    /// Process whole blocks using the fastest implementation available on this CPU.
+    /// Uses the portable implementation during constant evaluation.
+    static constexpr void processBlocks(uint32_t *state, const uint8_t *data, size_t numBlocks)
+    {
+        if consteval
+        {
+            processBlocksPortable(state, data, numBlocks);
+            return;
+        }
+        using ProcessBlocksFunc = void (*)(uint32_t *state, const uint8_t *data, size_t numBlocks);
+        static const ProcessBlocksFunc processBlocksFunc = []() -> ProcessBlocksFunc
+        {
+#ifdef LEANCRYPT_X86
+            const CpuFeatures &cpu = CpuFeatures::get();
+            if (cpu.sha && cpu.sse41)
+            {
+                return processBlocksShaNi;
+            }
+#endif
+            return processBlocksPortable;
+        }();
+        processBlocksFunc(state, data, numBlocks);
+    }
+
+    /// Process blocks (portable implementation).
+    static constexpr void processBlocksPortable(uint32_t *state, const uint8_t *data, size_t numBlocks)
+    {
+        for (; numBlocks > 0; numBlocks--)
+        {
+            processBlockPortable(state, data);
+            data += 64;
+        }
+    }
+
+    /// Process block (portable implementation).
+    static constexpr void processBlockPortable(uint32_t *state, const uint8_t *data)
     {
         uint32_t a = state[0];
         uint32_t b = state[1];
@@ -115,9 +312,9 @@ private:
         uint32_t W[16];
         for (unsigned t = 0; t < 16; t++)
         {
-            W[t] = byteSwap32LE(*reinterpret_cast<const uint32_t *>(data));
+            W[t] = loadBE32(data);
             data += 4;
-            uint32_t T = std::rotl(a, 5) + Ch(b, c, d) + e + 0x5a827999 + W[t];
+            uint32_t T = std::rotl(a, 5) + Ch(b, c, d) + e + K[0] + W[t];
             e = d;
             d = c;
             c = std::rotl(b, 30);
@@ -128,7 +325,7 @@ private:
         for (unsigned t = 16; t < 20; t++)
         {
             W[t & 0xf] = std::rotl(W[(t + 13) & 0x0f] ^ W[(t + 8) & 0x0f] ^ W[(t + 2) & 0xf] ^ W[t & 0xf], 1);
-            uint32_t T = std::rotl(a, 5) + Ch(b, c, d) + e + 0x5a827999 + W[t & 0xf];
+            uint32_t T = std::rotl(a, 5) + Ch(b, c, d) + e + K[0] + W[t & 0xf];
             e = d;
             d = c;
             c = std::rotl(b, 30);
@@ -139,7 +336,7 @@ private:
         for (unsigned t = 20; t < 40; t++)
         {
             W[t & 0xf] = std::rotl(W[(t + 13) & 0x0f] ^ W[(t + 8) & 0x0f] ^ W[(t + 2) & 0xf] ^ W[t & 0xf], 1);
-            uint32_t T = std::rotl(a, 5) + Par(b, c, d) + e + 0x6ed9eba1 + W[t & 0xf];
+            uint32_t T = std::rotl(a, 5) + Par(b, c, d) + e + K[1] + W[t & 0xf];
             e = d;
             d = c;
             c = std::rotl(b, 30);
@@ -150,7 +347,7 @@ private:
         for (unsigned t = 40; t < 60; t++)
         {
             W[t & 0xf] = std::rotl(W[(t + 13) & 0x0f] ^ W[(t + 8) & 0x0f] ^ W[(t + 2) & 0xf] ^ W[t & 0xf], 1);
-            uint32_t T = std::rotl(a, 5) + Maj(b, c, d) + e + 0x8f1bbcdc + W[t & 0xf];
+            uint32_t T = std::rotl(a, 5) + Maj(b, c, d) + e + K[2] + W[t & 0xf];
             e = d;
             d = c;
             c = std::rotl(b, 30);
@@ -161,7 +358,7 @@ private:
         for (unsigned t = 60; t < 80; t++)
         {
             W[t & 0xf] = std::rotl(W[(t + 13) & 0x0f] ^ W[(t + 8) & 0x0f] ^ W[(t + 2) & 0xf] ^ W[t & 0xf], 1);
-            uint32_t T = std::rotl(a, 5) + Par(b, c, d) + e + 0xca62c1d6 + W[t & 0xf];
+            uint32_t T = std::rotl(a, 5) + Par(b, c, d) + e + K[3] + W[t & 0xf];
             e = d;
             d = c;
             c = std::rotl(b, 30);
@@ -176,6 +373,153 @@ private:
         state[4] += e;
     }
 
+#ifdef LEANCRYPT_X86
+    /// Process blocks using the x86 SHA extensions (sha1rnds4, sha1nexte, sha1msg1, sha1msg2).
+    /// The SHA instructions operate on the state in the order DCBA with E in the most significant word of a second register.
+    __attribute__((target("sha,sse4.1"))) static void processBlocksShaNi(uint32_t *state, const uint8_t *data, size_t numBlocks)
+    {
+        const __m128i byteSwapMask = _mm_set_epi64x(0x0001020304050607ull, 0x08090a0b0c0d0e0full);
+
+        __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(state)), 0x1b);
+        __m128i e0 = _mm_set_epi32(static_cast<int>(state[4]), 0, 0, 0);
+
+        for (; numBlocks > 0; numBlocks--)
+        {
+            __m128i abcdSave = abcd;
+            __m128i e = e0;
+
+            // 20 * 4 rounds. m0 always holds the 4 message words for the current 4 rounds.
+            __m128i m0 = _mm_setzero_si128();
+            __m128i m1 = _mm_setzero_si128();
+            __m128i m2 = _mm_setzero_si128();
+            __m128i m3 = _mm_setzero_si128();
+            __m128i tmp;
+            unsigned i = 0;
+#define HashSha1_SHANI_ROUNDS20(func) \
+            for (unsigned j = 0; j < 5; j++, i++) \
+            { \
+                if (i < 4) \
+                { \
+                    m0 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i * 16)), byteSwapMask); \
+                } \
+                e = (i == 0) ? _mm_add_epi32(e, m0) : _mm_sha1nexte_epu32(e, m0); \
+                tmp = abcd; \
+                abcd = _mm_sha1rnds4_epu32(abcd, e, func); \
+                e = tmp; \
+                if ((i >= 3) && (i < 19)) \
+                { \
+                    m1 = _mm_sha1msg2_epu32(m1, m0); \
+                } \
+                if ((i >= 1) && (i < 17)) \
+                { \
+                    m3 = _mm_sha1msg1_epu32(m3, m0); \
+                } \
+                if ((i >= 2) && (i < 18)) \
+                { \
+                    m2 = _mm_xor_si128(m2, m0); \
+                } \
+                tmp = m0; \
+                m0 = m1; \
+                m1 = m2; \
+                m2 = m3; \
+                m3 = tmp; \
+            }
+            HashSha1_SHANI_ROUNDS20(0)
+            HashSha1_SHANI_ROUNDS20(1)
+            HashSha1_SHANI_ROUNDS20(2)
+            HashSha1_SHANI_ROUNDS20(3)
+#undef HashSha1_SHANI_ROUNDS20
+
+            e0 = _mm_sha1nexte_epu32(e, e0);
+            abcd = _mm_add_epi32(abcd, abcdSave);
+            data += 64;
+        }
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(state), _mm_shuffle_epi32(abcd, 0x1b));
+        state[4] = static_cast<uint32_t>(_mm_extract_epi32(e0, 3));
+    }
+
+    /// Process one block in each SIMD lane of V (multi-buffer implementation).
+    /// state is stored word-major: state[word * numLanes + lane].
+    /// Only pass vectors by pointer here: This is inlined into the target specific functions below.
+    template<class V>
+    __attribute__((always_inline)) static inline void processBlockLanes(uint32_t *state, const uint8_t *const *blocks)
+    {
+        constexpr unsigned numLanes = sizeof(V) / sizeof(uint32_t);
+        V s[5];
+        memcpy(s, state, sizeof(s));
+        V a = s[0];
+        V b = s[1];
+        V c = s[2];
+        V d = s[3];
+        V e = s[4];
+
+        V W[16];
+        for (unsigned t = 0; t < 16; t++)
+        {
+            for (unsigned lane = 0; lane < numLanes; lane++)
+            {
+                W[t][lane] = byteSwap32LE(*reinterpret_cast<const uint32_t *>(blocks[lane] + t * 4));
+            }
+        }
+
+#define HashSha1_ROTL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+#define HashSha1_ROUND(func, k) \
+        if (t >= 16) \
+        { \
+            V w = W[(t + 13) & 0xf] ^ W[(t + 8) & 0xf] ^ W[(t + 2) & 0xf] ^ W[t & 0xf]; \
+            W[t & 0xf] = HashSha1_ROTL(w, 1); \
+        } \
+        V T = HashSha1_ROTL(a, 5) + (func) + e + k + W[t & 0xf]; \
+        e = d; \
+        d = c; \
+        c = HashSha1_ROTL(b, 30); \
+        b = a; \
+        a = T;
+        unsigned t = 0;
+        for (; t < 20; t++)
+        {
+            HashSha1_ROUND((b & c) ^ (~b & d), K[0])
+        }
+        for (; t < 40; t++)
+        {
+            HashSha1_ROUND(b ^ c ^ d, K[1])
+        }
+        for (; t < 60; t++)
+        {
+            HashSha1_ROUND((b & c) ^ (b & d) ^ (c & d), K[2])
+        }
+        for (; t < 80; t++)
+        {
+            HashSha1_ROUND(b ^ c ^ d, K[3])
+        }
+#undef HashSha1_ROUND
+#undef HashSha1_ROTL
+
+        s[0] += a;
+        s[1] += b;
+        s[2] += c;
+        s[3] += d;
+        s[4] += e;
+        memcpy(state, s, sizeof(s));
+    }
+
+    /// Process 8 blocks in parallel using AVX2.
+    __attribute__((target("avx2"))) static void processBlockLanesAvx2(uint32_t *state, const uint8_t *const *blocks)
+    {
+        processBlockLanes<MultiBufferU32x8>(state, blocks);
+    }
+
+    /// Process 16 blocks in parallel using AVX-512.
+    __attribute__((target("avx512f"))) static void processBlockLanesAvx512(uint32_t *state, const uint8_t *const *blocks)
+    {
+        processBlockLanes<MultiBufferU32x16>(state, blocks);
+    }
+#endif
+
+    /// Round constants.
+    static constexpr uint32_t K[4] = { 0x5a827999, 0x6ed9eba1, 0x8f1bbcdc, 0xca62c1d6 };
+
     /// Initial state.
     static constexpr uint32_t initialState[5] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0 };
 
@@ -187,4 +531,16 @@ private:
 
     /// Message length in bytes.
     size_t messageLength;
+
+    /// Interface for multiBufferHash().
+    struct MultiBufferTraits
+    {
+        using Word = HashSha1::Word;
+        static constexpr size_t blockSize = HashSha1::blockSize;
+        static constexpr size_t stateWords = HashSha1::stateWords;
+        static constexpr size_t hashSize = HashSha1::hashSize;
+        static constexpr const uint32_t *initialState = HashSha1::initialState;
+        static size_t padMessage(uint8_t *block, size_t messageLength) { return HashSha1::padMessage(block, messageLength); }
+        static void storeHash(const uint32_t *state, uint8_t *hash) { HashSha1::storeHash(state, hash); }
+    };
 };
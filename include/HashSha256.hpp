@@ -9,14 +9,28 @@
 
 #include <stdint.h>
 #include <vector>
+#include <array>
+#include <span>
+#include <cassert>
 #include <algorithm>
+#include <bit>
 #include <cstring>
+#include "CpuFeatures.hpp"
+#include "Fragments.hpp"
+#include "Midstate.hpp"
+#include "MultiBuffer.hpp"
 
 /// SHA-256 implementation according to FIPS PUB 180-4.
 /// https://nvlpubs.nist.gov/nistpubs/FIPS/NIST.FIPS.180-4.pdf
 class HashSha256
 {
 public:
+    /// Hash size in bytes.
+    static constexpr size_t hashSize = 32;
+
+    /// Block size in bytes.
+    static constexpr size_t blockSize = 64;
+
     HashSha256()
     {
         clear();
@@ -47,47 +61,175 @@ public:
         }
 
         // Process whole blocks of input.
-        for (; n >= 64; bytes += 64, messageLength += 64, n -= 64)
-        {
-            processBlock(bytes);
-        }
+        size_t numBlocks = n / 64;
+        processBlocks(bytes, numBlocks);
+        bytes += numBlocks * 64;
+        messageLength += numBlocks * 64;
+        n -= numBlocks * 64;
 
         // Put remaining bytes into buffer.
         std::copy(bytes, bytes + n, buffer + bufferedBytes);
         messageLength += n;
     }
 
+    /// Add data from several buffers (scatter-gather input) in one pass, see updateFragments().
+    void updatev(std::span<const std::span<const uint8_t>> fragments)
+    {
+        messageLength += updateFragments<HashSha256>(state, buffer, messageLength % blockSize, fragments);
+    }
+
     /// Get hash.
     std::vector<uint8_t> finalize()
     {
-        // Pad message and calc final 1-2 blocks.
+        std::vector<uint8_t> r(hashSize);
+        finalizeInto(r.data());
+        return r;
+    }
+
+    /// Write hash to hash (room for at least hashSize bytes).
+    /// Does not allocate memory.
+    void finalize(std::span<uint8_t> hash)
+    {
+        assert(hash.size() >= hashSize);
+        finalizeInto(hash.data());
+    }
+
+    /// Get hash without allocating memory.
+    std::array<uint8_t, hashSize> finalizeArray()
+    {
+        std::array<uint8_t, hashSize> r;
+        finalizeInto(r.data());
+        return r;
+    }
+
+    /// Export the hasher state (chaining state, buffered bytes and message length) as versioned blob (see Midstate.hpp).
+    /// Use importState() to continue hashing later, for example to hash a common prefix only once.
+    std::vector<uint8_t> exportState() const
+    {
+        return Midstate::store(Midstate::Algorithm::sha256, hashSize, messageLength, state, 8, buffer, messageLength & 0x3f);
+    }
+
+    /// Import a state exported by exportState().
+    /// Return false and leave the hasher unchanged if blob is not a valid SHA-256 state.
+    bool importState(std::span<const uint8_t> blob)
+    {
+        uint32_t s[8];
+        uint64_t length;
+        std::span<const uint8_t> buffered;
+        if (!Midstate::load(blob, Midstate::Algorithm::sha256, hashSize, length, s, 8, buffered) || (buffered.size() != (length & 0x3f)))
+        {
+            return false;
+        }
+        std::copy(s, s + 8, state);
+        std::copy(buffered.begin(), buffered.end(), buffer);
+        messageLength = length;
+        return true;
+    }
+
+    /// Calculate the hash of n bytes in one go and write it to hash (hashSize bytes).
+    /// Can be used in constant expressions.
+    /// Faster than update() and finalize() for short messages: There is no buffering and messages of up to 55 bytes need exactly one compression.
+    static constexpr void calcHash(const uint8_t *bytes, size_t n, uint8_t *hash)
+    {
+        uint32_t s[8];
+        std::copy(initialState, initialState + 8, s);
+        size_t numBlocks = n / 64;
+        processBlocks(s, bytes, numBlocks);
+
+        // Pad the remaining bytes on the stack.
+        alignas(8) uint8_t block[128];
+        std::copy(bytes + numBlocks * 64, bytes + n, block);
+        processBlocks(s, block, padMessage(block, n));
+        storeHash(s, hash);
+    }
+
+    /// Calculate the hashes of count independent messages (multi-buffer hashing).
+    /// The hash of messages[i] (lengths[i] bytes) is written to hashes + i * hashSize.
+    /// On CPUs with AVX2/AVX-512 8/16 messages are hashed in parallel in the lanes of the SIMD registers.
+    static void calcHashes(const uint8_t *const *messages, const size_t *lengths, size_t count, uint8_t *hashes)
+    {
+#ifdef LEANCRYPT_X86
+        const CpuFeatures &cpu = CpuFeatures::get();
+        if (cpu.avx512f)
+        {
+            multiBufferHash<MultiBufferTraits, 16>(processBlockLanesAvx512, messages, lengths, count, hashes);
+            return;
+        }
+        if (cpu.avx2 && !cpu.sha)
+        {
+            multiBufferHash<MultiBufferTraits, 8>(processBlockLanesAvx2, messages, lengths, count, hashes);
+            return;
+        }
+#endif
+        for (size_t i = 0; i < count; i++)
+        {
+            calcHash(messages[i], lengths[i], hashes + i * hashSize);
+        }
+    }
+
+    /// Compression function interface (PBKDF2 iterates it directly on the HMAC key states).
+    /// The chaining state consists of stateWords words of type Word.
+    using Word = uint32_t;
+    static constexpr size_t stateWords = 8;
+
+    /// Copy the chaining state (stateWords words) to s.
+    /// Only valid at block boundaries, e.g. after the key block of HMAC.
+    void getChainingState(Word *s) const
+    {
+        assert(messageLength % blockSize == 0);
+        std::copy(state, state + stateWords, s);
+    }
+
+    /// Compress numBlocks whole blocks of data into the chaining state s.
+    static constexpr void compressBlocks(Word *s, const uint8_t *data, size_t numBlocks)
+    {
+        processBlocks(s, data, numBlocks);
+    }
+
+    /// Pad the last (messageLength % 64) message bytes in block (room for two blocks).
+    /// Return the number of blocks to process (1 or 2).
+    static constexpr size_t padMessage(uint8_t *block, size_t messageLength)
+    {
         size_t bufferedBytes = messageLength & 0x3f;
-        buffer[bufferedBytes] = 0x80;
-        memset(buffer + bufferedBytes + 1, 0, 64 - bufferedBytes - 1);
-        if (bufferedBytes + 9 > 64)
+        size_t numBlocks = (bufferedBytes + 9 > 64) ? 2 : 1;
+        block[bufferedBytes] = 0x80;
+        std::fill(block + bufferedBytes + 1, block + numBlocks * 64 - 8, 0);
+        // Message length in bits as big-endian 64-bit number.
+        uint64_t bitLength = uint64_t(messageLength) << 3;
+        for (unsigned i = 0; i < 8; i++)
         {
-            processBlock(buffer);
-            memset(buffer, 0, 64 - 8);
+            block[numBlocks * 64 - 1 - i] = uint8_t(bitLength >> (i * 8));
         }
-        uint32_t *buffer32 = reinterpret_cast<uint32_t *>(buffer);
-        buffer32[14] = byteSwap32LE(messageLength >> 29);
-        buffer32[15] = byteSwap32LE(messageLength << 3);
-        processBlock(buffer);
+        return numBlocks;
+    }
 
-        // Return hash.
-        std::vector<uint8_t> r(32);
-        uint32_t *data = reinterpret_cast<uint32_t *>(r.data());
+    /// Store state as big-endian hash.
+    static constexpr void storeHash(const uint32_t *state, uint8_t *hash)
+    {
         for (unsigned i = 0; i < 8; i++)
         {
-            *(data++) = byteSwap32LE(state[i]);
+            hash[i * 4 + 0] = uint8_t(state[i] >> 24);
+            hash[i * 4 + 1] = uint8_t(state[i] >> 16);
+            hash[i * 4 + 2] = uint8_t(state[i] >> 8);
+            hash[i * 4 + 3] = uint8_t(state[i]);
         }
-        clear();
-        return r;
     }
 
 private:
+    /// Write hash to hash (hashSize bytes) and clear hasher.
+    void finalizeInto(uint8_t *hash)
+    {
+        // Pad message and calc final 1-2 blocks.
+        alignas(8) uint8_t block[128];
+        std::copy(buffer, buffer + (messageLength & 0x3f), block);
+        processBlocks(block, padMessage(block, messageLength));
+
+        storeHash(state, hash);
+        clear();
+    }
+
     /// Reverse bytes in 32-bit word on little-endian machines.
-    uint32_t byteSwap32LE(uint32_t x)
+    static constexpr uint32_t byteSwap32LE(uint32_t x)
     {
 #ifdef __BIG_ENDIAN__
         return x;
@@ -97,16 +239,84 @@ private:
 #endif
     }
 
+    /// Load big-endian 32-bit word.
+    static constexpr uint32_t loadBE32(const uint8_t *data)
+    {
+        if consteval
+        {
+            return (uint32_t(data[0]) << 24) | (uint32_t(data[1]) << 16) | (uint32_t(data[2]) << 8) | data[3];
+        }
+        return byteSwap32LE(*reinterpret_cast<const uint32_t *>(data));
+    }
+
     /// Helper functions.
-    static uint32_t Sig0(uint32_t x) { return std::rotr(x, 2) ^ std::rotr(x, 13) ^ std::rotr(x, 22); }
-    static uint32_t Sig1(uint32_t x) { return std::rotr(x, 6) ^ std::rotr(x, 11) ^ std::rotr(x, 25); }
-    static uint32_t sig0(uint32_t x) { return std::rotr(x, 7) ^ std::rotr(x, 18) ^ (x >> 3); }
-    static uint32_t sig1(uint32_t x) { return std::rotr(x, 17) ^ std::rotr(x, 19) ^ (x >> 10); }
-    static uint32_t Ch(uint32_t x, uint32_t y, uint32_t z) { return (x & y) ^ ((~x) & z); }
-    static uint32_t Maj(uint32_t x, uint32_t y, uint32_t z) { return (x & y) ^ (x & z) ^ (y & z); }
+    static constexpr uint32_t Sig0(uint32_t x) { return std::rotr(x, 2) ^ std::rotr(x, 13) ^ std::rotr(x, 22); }
+    static constexpr uint32_t Sig1(uint32_t x) { return std::rotr(x, 6) ^ std::rotr(x, 11) ^ std::rotr(x, 25); }
+    static constexpr uint32_t sig0(uint32_t x) { return std::rotr(x, 7) ^ std::rotr(x, 18) ^ (x >> 3); }
+    static constexpr uint32_t sig1(uint32_t x) { return std::rotr(x, 17) ^ std::rotr(x, 19) ^ (x >> 10); }
+    static constexpr uint32_t Ch(uint32_t x, uint32_t y, uint32_t z) { return (x & y) ^ ((~x) & z); }
+    static constexpr uint32_t Maj(uint32_t x, uint32_t y, uint32_t z) { return (x & y) ^ (x & z) ^ (y & z); }
 
     /// Process block.
     void processBlock(const uint8_t *data)
+    {
+        processBlocks(data, 1);
+    }
+
+    /// Process whole blocks.
+    void processBlocks(const uint8_t *data, size_t numBlocks)
+    {
+        processBlocks(state, data, numBlocks);
+    }
+
+    /// Process whole blocks using the fastest implementation available on this CPU.
+    /// Uses the portable implementation during constant evaluation.
+    static constexpr void processBlocks(uint32_t *state, const uint8_t *data, size_t numBlocks)
+    {
+        if consteval
+        {
+            processBlocksPortable(state, data, numBlocks);
+            return;
+        }
+        using ProcessBlocksFunc = void (*)(uint32_t *state, const uint8_t *data, size_t numBlocks);
+        static const ProcessBlocksFunc processBlocksFunc = []() -> ProcessBlocksFunc
+        {
+#ifdef LEANCRYPT_X86
+            const CpuFeatures &cpu = CpuFeatures::get();
+            if (cpu.sha && cpu.sse41)
+            {
+                return processBlocksShaNi;
+            }
+            if (cpu.avx2 && cpu.bmi2)
+            {
+                return processBlocksAvx2;
+            }
+            if (cpu.avx)
+            {
+                return processBlocksAvx;
+            }
+            if (cpu.ssse3)
+            {
+                return processBlocksSsse3;
+            }
+#endif
+            return processBlocksPortable;
+        }();
+        processBlocksFunc(state, data, numBlocks);
+    }
+
+    /// Process blocks (portable implementation).
+    static constexpr void processBlocksPortable(uint32_t *state, const uint8_t *data, size_t numBlocks)
+    {
+        for (; numBlocks > 0; numBlocks--)
+        {
+            processBlockPortable(state, data);
+            data += 64;
+        }
+    }
+
+    /// Process block (portable implementation).
+    static constexpr void processBlockPortable(uint32_t *state, const uint8_t *data)
     {
         uint32_t a = state[0];
         uint32_t b = state[1];
@@ -120,7 +330,7 @@ private:
         uint32_t W[16];
         for (unsigned t = 0; t < 16; t++)
         {
-            W[t] = byteSwap32LE(*reinterpret_cast<const uint32_t *>(data));
+            W[t] = loadBE32(data);
             data += 4;
             uint32_t T1 = h + Sig1(e) + Ch(e, f, g) + K256[t] + W[t];
             uint32_t T2 = Sig0(a) + Maj(a, b, c);
@@ -159,6 +369,275 @@ private:
         state[7] += h;
     }
 
+#ifdef LEANCRYPT_X86
+    /// Process blocks using the x86 SHA extensions (sha256rnds2, sha256msg1, sha256msg2).
+    /// The SHA instructions operate on the state in the order ABEF/CDGH.
+    __attribute__((target("sha,sse4.1"))) static void processBlocksShaNi(uint32_t *state, const uint8_t *data, size_t numBlocks)
+    {
+        const __m128i byteSwapMask = _mm_set_epi64x(0x0c0d0e0f08090a0bull, 0x0405060700010203ull);
+
+        // Convert state from ABCD/EFGH to ABEF/CDGH.
+        __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(state)), 0xb1);
+        __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(state + 4)), 0x1b);
+        __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+        state1 = _mm_blend_epi16(state1, tmp, 0xf0);
+
+        for (; numBlocks > 0; numBlocks--)
+        {
+            __m128i abefSave = state0;
+            __m128i cdghSave = state1;
+
+            // 16 * 4 rounds. m0 always holds the 4 message words for the current 4 rounds.
+            __m128i m0 = _mm_setzero_si128();
+            __m128i m1 = _mm_setzero_si128();
+            __m128i m2 = _mm_setzero_si128();
+            __m128i m3 = _mm_setzero_si128();
+            for (unsigned i = 0; i < 16; i++)
+            {
+                if (i < 4)
+                {
+                    m0 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i * 16)), byteSwapMask);
+                }
+                __m128i msg = _mm_add_epi32(m0, _mm_loadu_si128(reinterpret_cast<const __m128i *>(K256 + i * 4)));
+                state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+                if ((i >= 3) && (i < 15))
+                {
+                    m1 = _mm_sha256msg2_epu32(_mm_add_epi32(m1, _mm_alignr_epi8(m0, m3, 4)), m0);
+                }
+                msg = _mm_shuffle_epi32(msg, 0x0e);
+                state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+                if ((i >= 1) && (i < 13))
+                {
+                    m3 = _mm_sha256msg1_epu32(m3, m0);
+                }
+                tmp = m0;
+                m0 = m1;
+                m1 = m2;
+                m2 = m3;
+                m3 = tmp;
+            }
+
+            state0 = _mm_add_epi32(state0, abefSave);
+            state1 = _mm_add_epi32(state1, cdghSave);
+            data += 64;
+        }
+
+        // Convert state from ABEF/CDGH back to ABCD/EFGH.
+        tmp = _mm_shuffle_epi32(state0, 0x1b);
+        state1 = _mm_shuffle_epi32(state1, 0xb1);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(state), _mm_blend_epi16(tmp, state1, 0xf0));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(state + 4), _mm_alignr_epi8(state1, tmp, 8));
+    }
+
+    /// One round with precalculated W + K.
+    /// The caller rotates the roles of the state variables instead of moving the values.
+    static void round(uint32_t a, uint32_t b, uint32_t c, uint32_t &d, uint32_t e, uint32_t f, uint32_t g, uint32_t &h, uint32_t wk)
+    {
+        uint32_t T1 = h + Sig1(e) + Ch(e, f, g) + wk;
+        d += T1;
+        h = T1 + Sig0(a) + Maj(a, b, c);
+    }
+
+    /// Process the 64 rounds of one block with precalculated W + K.
+    /// W[t] + K[t] is at WK[(t / 4) * groupStride + t % 4].
+    __attribute__((always_inline)) static inline void processRounds(uint32_t *state, const uint32_t *WK, unsigned groupStride)
+    {
+        uint32_t a = state[0];
+        uint32_t b = state[1];
+        uint32_t c = state[2];
+        uint32_t d = state[3];
+        uint32_t e = state[4];
+        uint32_t f = state[5];
+        uint32_t g = state[6];
+        uint32_t h = state[7];
+        for (unsigned t = 0; t < 64; t += 8, WK += groupStride * 2)
+        {
+            round(a, b, c, d, e, f, g, h, WK[0]);
+            round(h, a, b, c, d, e, f, g, WK[1]);
+            round(g, h, a, b, c, d, e, f, WK[2]);
+            round(f, g, h, a, b, c, d, e, WK[3]);
+            round(e, f, g, h, a, b, c, d, WK[groupStride]);
+            round(d, e, f, g, h, a, b, c, WK[groupStride + 1]);
+            round(c, d, e, f, g, h, a, b, WK[groupStride + 2]);
+            round(b, c, d, e, f, g, h, a, WK[groupStride + 3]);
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+
+    /// sig0() and sig1() of four message words.
+    __attribute__((target("ssse3"))) static __m128i sig0x4(__m128i x) { return _mm_xor_si128(_mm_xor_si128(_mm_or_si128(_mm_srli_epi32(x, 7), _mm_slli_epi32(x, 25)), _mm_or_si128(_mm_srli_epi32(x, 18), _mm_slli_epi32(x, 14))), _mm_srli_epi32(x, 3)); }
+    __attribute__((target("ssse3"))) static __m128i sig1x4(__m128i x) { return _mm_xor_si128(_mm_xor_si128(_mm_or_si128(_mm_srli_epi32(x, 17), _mm_slli_epi32(x, 15)), _mm_or_si128(_mm_srli_epi32(x, 19), _mm_slli_epi32(x, 13))), _mm_srli_epi32(x, 10)); }
+
+    /// Calculate the next four message words W[t..t+3] into w0 (which holds W[t-16..t-13]) and store W + K to WK.
+    /// wN holds W[t-16+4N..t-13+4N].
+    /// sig1() depends on W[t-2], so it is applied to W[t..t+1] first and then to W[t+2..t+3] (sig1(0) is 0).
+    __attribute__((target("ssse3"))) static void scheduleMessageX4(__m128i &w0, __m128i w1, __m128i w2, __m128i w3, uint32_t *WK, unsigned t)
+    {
+        w0 = _mm_add_epi32(_mm_add_epi32(w0, sig0x4(_mm_alignr_epi8(w1, w0, 4))), _mm_alignr_epi8(w3, w2, 4));
+        w0 = _mm_add_epi32(w0, sig1x4(_mm_srli_si128(w3, 8)));
+        w0 = _mm_add_epi32(w0, sig1x4(_mm_slli_si128(w0, 8)));
+        _mm_store_si128(reinterpret_cast<__m128i *>(WK + t), _mm_add_epi32(w0, _mm_loadu_si128(reinterpret_cast<const __m128i *>(K256 + t))));
+    }
+
+    /// Process blocks using SSSE3.
+    /// The byte swap and the message schedule are calculated four words at a time in SIMD registers.
+    __attribute__((target("ssse3"), always_inline)) static inline void processBlocksSsse3(uint32_t *state, const uint8_t *data, size_t numBlocks)
+    {
+        const __m128i byteSwapMask = _mm_set_epi64x(0x0c0d0e0f08090a0bull, 0x0405060700010203ull);
+        alignas(16) uint32_t WK[64];
+        for (; numBlocks > 0; numBlocks--)
+        {
+            __m128i w[4];
+            for (unsigned i = 0; i < 4; i++)
+            {
+                w[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i * 16)), byteSwapMask);
+                _mm_store_si128(reinterpret_cast<__m128i *>(WK + i * 4), _mm_add_epi32(w[i], _mm_loadu_si128(reinterpret_cast<const __m128i *>(K256 + i * 4))));
+            }
+            __m128i w0 = w[0], w1 = w[1], w2 = w[2], w3 = w[3];
+            for (unsigned t = 16; t < 64; t += 16)
+            {
+                scheduleMessageX4(w0, w1, w2, w3, WK, t);
+                scheduleMessageX4(w1, w2, w3, w0, WK, t + 4);
+                scheduleMessageX4(w2, w3, w0, w1, WK, t + 8);
+                scheduleMessageX4(w3, w0, w1, w2, WK, t + 12);
+            }
+            processRounds(state, WK, 4);
+            data += 64;
+        }
+    }
+
+    /// Process blocks using AVX (SSSE3 code with VEX encoding).
+    __attribute__((target("avx"))) static void processBlocksAvx(uint32_t *state, const uint8_t *data, size_t numBlocks)
+    {
+        processBlocksSsse3(state, data, numBlocks);
+    }
+
+    /// sig0() and sig1() of four message words of two blocks.
+    __attribute__((target("avx2,bmi2"))) static __m256i sig0x8(__m256i x) { return _mm256_xor_si256(_mm256_xor_si256(_mm256_or_si256(_mm256_srli_epi32(x, 7), _mm256_slli_epi32(x, 25)), _mm256_or_si256(_mm256_srli_epi32(x, 18), _mm256_slli_epi32(x, 14))), _mm256_srli_epi32(x, 3)); }
+    __attribute__((target("avx2,bmi2"))) static __m256i sig1x8(__m256i x) { return _mm256_xor_si256(_mm256_xor_si256(_mm256_or_si256(_mm256_srli_epi32(x, 17), _mm256_slli_epi32(x, 15)), _mm256_or_si256(_mm256_srli_epi32(x, 19), _mm256_slli_epi32(x, 13))), _mm256_srli_epi32(x, 10)); }
+
+    /// Same as scheduleMessageX4() for two interleaved blocks (one block per 128-bit half).
+    __attribute__((target("avx2,bmi2"))) static void scheduleMessageX8(__m256i &w0, __m256i w1, __m256i w2, __m256i w3, uint32_t *WK, unsigned t)
+    {
+        w0 = _mm256_add_epi32(_mm256_add_epi32(w0, sig0x8(_mm256_alignr_epi8(w1, w0, 4))), _mm256_alignr_epi8(w3, w2, 4));
+        w0 = _mm256_add_epi32(w0, sig1x8(_mm256_bsrli_epi128(w3, 8)));
+        w0 = _mm256_add_epi32(w0, sig1x8(_mm256_bslli_epi128(w0, 8)));
+        _mm256_store_si256(reinterpret_cast<__m256i *>(WK + t * 2), _mm256_add_epi32(w0, _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(K256 + t)))));
+    }
+
+    /// Process blocks using AVX2 and BMI2.
+    /// The message schedules of two blocks are calculated together in the two halves of the 256-bit registers.
+    /// The rounds use the BMI2 rorx instruction for the rotations of Sig0() and Sig1().
+    __attribute__((target("avx2,bmi2"))) static void processBlocksAvx2(uint32_t *state, const uint8_t *data, size_t numBlocks)
+    {
+        const __m256i byteSwapMask = _mm256_set_epi64x(0x0c0d0e0f08090a0bull, 0x0405060700010203ull, 0x0c0d0e0f08090a0bull, 0x0405060700010203ull);
+        alignas(32) uint32_t WK[128];
+        for (; numBlocks >= 2; numBlocks -= 2)
+        {
+            __m256i w[4];
+            for (unsigned i = 0; i < 4; i++)
+            {
+                w[i] = _mm256_shuffle_epi8(_mm256_set_m128i(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 64 + i * 16)), _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i * 16))), byteSwapMask);
+                _mm256_store_si256(reinterpret_cast<__m256i *>(WK + i * 8), _mm256_add_epi32(w[i], _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(K256 + i * 4)))));
+            }
+            __m256i w0 = w[0], w1 = w[1], w2 = w[2], w3 = w[3];
+            for (unsigned t = 16; t < 64; t += 16)
+            {
+                scheduleMessageX8(w0, w1, w2, w3, WK, t);
+                scheduleMessageX8(w1, w2, w3, w0, WK, t + 4);
+                scheduleMessageX8(w2, w3, w0, w1, WK, t + 8);
+                scheduleMessageX8(w3, w0, w1, w2, WK, t + 12);
+            }
+            processRounds(state, WK, 8);
+            processRounds(state, WK + 4, 8);
+            data += 128;
+        }
+        if (numBlocks > 0)
+        {
+            processBlocksSsse3(state, data, numBlocks);
+        }
+    }
+
+    /// Process one block in each SIMD lane of V (multi-buffer implementation).
+    /// state is stored word-major: state[word * numLanes + lane].
+    /// Only pass vectors by pointer here: This is inlined into the target specific functions below.
+    template<class V>
+    __attribute__((always_inline)) static inline void processBlockLanes(uint32_t *state, const uint8_t *const *blocks)
+    {
+        constexpr unsigned numLanes = sizeof(V) / sizeof(uint32_t);
+#define HashSha256_ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+        V s[8];
+        memcpy(s, state, sizeof(s));
+        V a = s[0];
+        V b = s[1];
+        V c = s[2];
+        V d = s[3];
+        V e = s[4];
+        V f = s[5];
+        V g = s[6];
+        V h = s[7];
+
+        V W[16];
+        for (unsigned t = 0; t < 16; t++)
+        {
+            for (unsigned lane = 0; lane < numLanes; lane++)
+            {
+                W[t][lane] = byteSwap32LE(*reinterpret_cast<const uint32_t *>(blocks[lane] + t * 4));
+            }
+        }
+
+        for (unsigned t = 0; t < 64; t++)
+        {
+            if (t >= 16)
+            {
+                V w1 = W[(t + 1) & 0xf];
+                V w14 = W[(t + 14) & 0xf];
+                W[t & 0xf] += (HashSha256_ROTR(w1, 7) ^ HashSha256_ROTR(w1, 18) ^ (w1 >> 3)) + (HashSha256_ROTR(w14, 17) ^ HashSha256_ROTR(w14, 19) ^ (w14 >> 10)) + W[(t + 9) & 0xf];
+            }
+            V T1 = h + (HashSha256_ROTR(e, 6) ^ HashSha256_ROTR(e, 11) ^ HashSha256_ROTR(e, 25)) + ((e & f) ^ (~e & g)) + K256[t] + W[t & 0xf];
+            V T2 = (HashSha256_ROTR(a, 2) ^ HashSha256_ROTR(a, 13) ^ HashSha256_ROTR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + T1;
+            d = c;
+            c = b;
+            b = a;
+            a = T1 + T2;
+        }
+#undef HashSha256_ROTR
+
+        s[0] += a;
+        s[1] += b;
+        s[2] += c;
+        s[3] += d;
+        s[4] += e;
+        s[5] += f;
+        s[6] += g;
+        s[7] += h;
+        memcpy(state, s, sizeof(s));
+    }
+
+    /// Process 8 blocks in parallel using AVX2.
+    __attribute__((target("avx2"))) static void processBlockLanesAvx2(uint32_t *state, const uint8_t *const *blocks)
+    {
+        processBlockLanes<MultiBufferU32x8>(state, blocks);
+    }
+
+    /// Process 16 blocks in parallel using AVX-512.
+    __attribute__((target("avx512f"))) static void processBlockLanesAvx512(uint32_t *state, const uint8_t *const *blocks)
+    {
+        processBlockLanes<MultiBufferU32x16>(state, blocks);
+    }
+#endif
+
     static constexpr uint32_t K256[] = {
         0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
         0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
@@ -181,4 +660,16 @@ private:
 
     /// Message length in bytes.
     size_t messageLength;
+
+    /// Interface for multiBufferHash().
+    struct MultiBufferTraits
+    {
+        using Word = HashSha256::Word;
+        static constexpr size_t blockSize = HashSha256::blockSize;
+        static constexpr size_t stateWords = HashSha256::stateWords;
+        static constexpr size_t hashSize = HashSha256::hashSize;
+        static constexpr const uint32_t *initialState = HashSha256::initialState;
+        static size_t padMessage(uint8_t *block, size_t messageLength) { return HashSha256::padMessage(block, messageLength); }
+        static void storeHash(const uint32_t *state, uint8_t *hash) { HashSha256::storeHash(state, hash); }
+    };
 };
@@ -9,129 +9,157 @@
 
 #include <stdint.h>
 #include <vector>
+#include <array>
+#include <span>
+#include <cassert>
 #include <algorithm>
 #include <bit>
+#include <cstring>
+#include "KeccakP1600.hpp"
+#include "KeccakSponge.hpp"
+#include "Midstate.hpp"
+#include "KeccakMultiBuffer.hpp"
 
 /// SHA-3 implementation according to FIPS PUB 202.
 /// https://nvlpubs.nist.gov/nistpubs/FIPS/NIST.FIPS.202.pdf
 /// Please use class HashSha3_128, HashSha3_224, HashSha3_256, HashSha3_384 or HashSha3_512 etc instead (see bottom of file).
-class HashSha3
+template<size_t hashSizeInBits>
+class HashSha3: private KeccakSponge<200 - hashSizeInBits / 4>
 {
+    /// Sponge with capacity 2 * hashSizeInBits (absorbs the data, pads and squeezes the hash).
+    using Sponge = KeccakSponge<200 - hashSizeInBits / 4>;
+
 public:
-    HashSha3(size_t hashSizeInBits = 224):
-    hashSizeBytes(hashSizeInBits / 8),
-    blockSizeBytes(200 - 2 * hashSizeBytes)
-    {
-        clear();
-    }
+    /// Hash size in bytes.
+    static constexpr size_t hashSize = hashSizeInBits / 8;
+
+    /// Block size (rate) in bytes.
+    static constexpr size_t blockSize = Sponge::blockSize;
 
     /// Initialize hasher.
     /// Call this after retrieving the hash and before calculating a new hash of new data.
     void clear()
     {
-        std::fill(state, state + 25, 0);
-        bufferPos = 0;
+        Sponge::clear();
     }
 
     /// Add data.
     void update(const uint8_t *bytes, size_t n)
     {
-        uint8_t *state8 = reinterpret_cast<uint8_t*>(state);
-        for (size_t i = 0; i < n;)
+        Sponge::absorb(bytes, n);
+    }
+
+    /// Add data from several buffers (scatter-gather input).
+    /// The sponge xors the fragments directly into the state at its current position, so no bytes are copied.
+    void updatev(std::span<const std::span<const uint8_t>> fragments)
+    {
+        for (std::span<const uint8_t> fragment: fragments)
         {
-            if (((bufferPos & 7) == 0) && ((n - i) >= 8) && ((blockSizeBytes - bufferPos) >= 8))
-            {
-                for (;((n - i) >= 8) && ((blockSizeBytes - bufferPos) >= 8); bufferPos += 8, i += 8)
-                {
-                    state[bufferPos >> 3] ^= *reinterpret_cast<const uint64_t*>(&bytes[i]);
-                }
-            }
-            else if ((i < n) && (bufferPos < blockSizeBytes))
-            {
-                state8[bufferPos++] ^= bytes[i++];
-            }
-            if (bufferPos >= blockSizeBytes)
-            {
-                processBlock();
-                bufferPos = 0;
-            }
+            Sponge::absorb(fragment.data(), fragment.size());
         }
     }
 
     /// Get hash.
     std::vector<uint8_t> finalize()
     {
-        uint8_t *state8 = reinterpret_cast<uint8_t*>(state);
-        state8[bufferPos] ^= 0x06;
-        state8[blockSizeBytes - 1] ^= 0x80;
-        processBlock();
-
-        return std::vector<uint8_t>(state8, state8 + hashSizeBytes);
+        std::vector<uint8_t> r(hashSize);
+        finalizeInto(r.data());
+        return r;
     }
 
-private:
-    void processBlock()
+    /// Write hash to hash (room for at least hashSize bytes).
+    /// Does not allocate memory.
+    void finalize(std::span<uint8_t> hash)
     {
-#define HashSha3_REPEAT5(x) x x x x x
-#define HashSha3_REPEAT24(x) x x x x x x x x x x x x x x x x x x x x x x x x
-#define HashSha3_FOR5(var, step, code) var = 0; HashSha3_REPEAT5(code; var += step;)
-#define HashSha3_FOR24(var, step, code) var = 0; HashSha3_REPEAT24(code; var += step;)
-        uint64_t c[5];
-        unsigned round, i, j;
-        HashSha3_FOR24(round, 1,
-            // Theta.
-            HashSha3_FOR5(i, 1, c[i] = state[i] ^ state[i + 5] ^ state[i + 10] ^ state[i + 15] ^ state[i + 20];)
-            HashSha3_FOR5(i, 1, HashSha3_FOR5(j, 5, state[j + i] ^= c[(i + 4) % 5] ^ std::rotl(c[(i + 1) % 5], 1);))
-
-            // Rho and Pi.
-            c[1] = state[1];
-            HashSha3_FOR24(i, 1, j = piOffsets[i]; c[0] = state[j]; state[j] = std::rotl(c[1], rhoRotate[i]); c[1] = c[0];)
-
-            // Chi.
-            HashSha3_FOR5(j, 5, HashSha3_FOR5(i, 1, c[i] = state[j + i];) HashSha3_FOR5(i, 1, state[j + i] ^= (~c[(i + 1) % 5]) & c[(i + 2) % 5];))
-
-            // Iota.
-            state[0] ^= iota[round];
-        )
-#undef HashSha3_REPEAT5
-#undef HashSha3_REPEAT24
-#undef HashSha3_FOR5
-#undef HashSha3_FOR24
+        assert(hash.size() >= hashSize);
+        finalizeInto(hash.data());
     }
 
-    /// Iota constants.
-    static constexpr uint64_t iota[24] =
+    /// Get hash without allocating memory.
+    std::array<uint8_t, hashSize> finalizeArray()
     {
-        0x0000000000000001, 0x0000000000008082, 0x800000000000808a, 0x8000000080008000,
-        0x000000000000808b, 0x0000000080000001, 0x8000000080008081, 0x8000000000008009,
-        0x000000000000008a, 0x0000000000000088, 0x0000000080008009, 0x000000008000000a,
-        0x000000008000808b, 0x800000000000008b, 0x8000000000008089, 0x8000000000008003,
-        0x8000000000008002, 0x8000000000000080, 0x000000000000800a, 0x800000008000000a,
-        0x8000000080008081, 0x8000000000008080, 0x0000000080000001, 0x8000000080008008
-    };
+        std::array<uint8_t, hashSize> r;
+        finalizeInto(r.data());
+        return r;
+    }
 
-    /// Rho rotation.
-    static constexpr unsigned rhoRotate[24] = { 1, 3, 6, 10, 15, 21, 28, 36, 45, 55, 2, 14, 27, 41, 56, 8, 25, 43, 62, 18, 39, 61, 20, 44};
+    /// Export the hasher state (Keccak state with the absorbed bytes and byte position in the current block) as versioned blob (see Midstate.hpp).
+    /// Use importState() to continue hashing later, for example to hash a common prefix only once.
+    std::vector<uint8_t> exportState() const
+    {
+        return Midstate::store(Midstate::Algorithm::sha3, hashSize, this->pos, this->state, 25, nullptr, 0);
+    }
 
-    /// Pi permutation offsets.
-    static constexpr unsigned piOffsets[24] = { 10, 7, 11, 17, 18, 3, 5, 16, 8, 21, 24, 4, 15, 23, 19, 13, 12, 2, 20, 14, 22, 9, 6, 1};
+    /// Import a state exported by exportState().
+    /// Return false and leave the hasher unchanged if blob is not a valid state of this SHA-3 variant.
+    bool importState(std::span<const uint8_t> blob)
+    {
+        uint64_t s[25];
+        uint64_t pos;
+        std::span<const uint8_t> buffered;
+        if (!Midstate::load(blob, Midstate::Algorithm::sha3, hashSize, pos, s, 25, buffered) || !buffered.empty() || (pos >= blockSize))
+        {
+            return false;
+        }
+        std::copy(s, s + 25, this->state);
+        this->pos = pos;
+        this->squeezing = false;
+        return true;
+    }
 
-    /// State.
-    uint64_t state[25];
+    /// Calculate the hash of n bytes in one go and write it to hash (hashSize bytes).
+    /// Faster than update() and finalize() for short messages: The padding is xored directly into a state on the stack and messages shorter than blockSize need exactly one permutation.
+    /// Can be used in constant expressions.
+    static constexpr void calcHash(const uint8_t *bytes, size_t n, uint8_t *hash)
+    {
+        uint64_t s[25] = {};
+        for (; n >= blockSize; bytes += blockSize, n -= blockSize)
+        {
+            Sponge::absorbBlock(s, bytes);
+        }
 
-    /// Hash size in bytes.
-    size_t hashSizeBytes;
+        // Lanes are little-endian.
+        for (size_t i = 0; i < n; i++)
+        {
+            s[i / 8] ^= uint64_t(bytes[i]) << (i % 8 * 8);
+        }
+        s[n / 8] ^= uint64_t(0x06) << (n % 8 * 8);
+        s[blockSize / 8 - 1] ^= uint64_t(0x80) << 56;
+        KeccakP1600<24>::permute(s);
+        for (size_t i = 0; i < hashSize; i++)
+        {
+            hash[i] = uint8_t(s[i / 8] >> (i % 8 * 8));
+        }
+    }
 
-    /// Block size in bytes.
-    size_t blockSizeBytes;
+    /// Calculate the hashes of count independent messages (multi-buffer hashing).
+    /// The hash of messages[i] (lengths[i] bytes) is written to hashes + i * hashSize.
+    /// On CPUs with AVX2/AVX-512 4/8 Keccak states are permuted in parallel in the lanes of the SIMD registers.
+    static void calcHashes(const uint8_t *const *messages, const size_t *lengths, size_t count, uint8_t *hashes)
+    {
+        if (KeccakMultiBuffer<blockSize, 0x06, hashSize>::calcHashes(messages, lengths, count, hashes))
+        {
+            return;
+        }
+        for (size_t i = 0; i < count; i++)
+        {
+            calcHash(messages[i], lengths[i], hashes + i * hashSize);
+        }
+    }
 
-    /// Byte position in state buffer.
-    size_t bufferPos;
+private:
+    /// Write hash to hash (hashSize bytes) and clear hasher.
+    void finalizeInto(uint8_t *hash)
+    {
+        Sponge::pad(0x06);
+        Sponge::squeeze(hash, hashSize);
+        clear();
+    }
 };
 
 /// SHA-3 variants for the defined hash sizes.
-class HashSha3_128: public HashSha3 { public: HashSha3_128(): HashSha3(128) {} }; // Non-standard, but fast
-class HashSha3_224: public HashSha3 { public: HashSha3_224(): HashSha3(224) {} };
-class HashSha3_256: public HashSha3 { public: HashSha3_256(): HashSha3(256) {} };
-class HashSha3_384: public HashSha3 { public: HashSha3_384(): HashSha3(384) {} };
-class HashSha3_512: public HashSha3 { public: HashSha3_512(): HashSha3(512) {} };
+class HashSha3_128: public HashSha3<128> {}; // Non-standard, but fast
+class HashSha3_224: public HashSha3<224> {};
+class HashSha3_256: public HashSha3<256> {};
+class HashSha3_384: public HashSha3<384> {};
+class HashSha3_512: public HashSha3<512> {};
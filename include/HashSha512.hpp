@@ -9,14 +9,28 @@
 
 #include <stdint.h>
 #include <vector>
+#include <array>
+#include <span>
+#include <cassert>
 #include <algorithm>
+#include <bit>
 #include <cstring>
+#include "CpuFeatures.hpp"
+#include "Fragments.hpp"
+#include "Midstate.hpp"
+#include "MultiBuffer.hpp"
 
 /// SHA-512 implementation according to FIPS PUB 180-4.
 /// https://nvlpubs.nist.gov/nistpubs/FIPS/NIST.FIPS.180-4.pdf
 class HashSha512
 {
 public:
+    /// Hash size in bytes.
+    static constexpr size_t hashSize = 64;
+
+    /// Block size in bytes.
+    static constexpr size_t blockSize = 128;
+
     HashSha512()
     {
         clear();
@@ -47,47 +61,175 @@ public:
         }
 
         // Process whole blocks of input.
-        for (; n >= 128; bytes += 128, messageLength += 128, n -= 128)
-        {
-            processBlock(bytes);
-        }
+        size_t numBlocks = n / 128;
+        processBlocks(bytes, numBlocks);
+        bytes += numBlocks * 128;
+        messageLength += numBlocks * 128;
+        n -= numBlocks * 128;
 
         // Put remaining bytes into buffer.
         std::copy(bytes, bytes + n, buffer + bufferedBytes);
         messageLength += n;
     }
 
+    /// Add data from several buffers (scatter-gather input) in one pass, see updateFragments().
+    void updatev(std::span<const std::span<const uint8_t>> fragments)
+    {
+        messageLength += updateFragments<HashSha512>(state, buffer, messageLength % blockSize, fragments);
+    }
+
     /// Get hash.
     std::vector<uint8_t> finalize()
     {
-        // Pad message and calc final 1-2 blocks.
+        std::vector<uint8_t> r(hashSize);
+        finalizeInto(r.data());
+        return r;
+    }
+
+    /// Write hash to hash (room for at least hashSize bytes).
+    /// Does not allocate memory.
+    void finalize(std::span<uint8_t> hash)
+    {
+        assert(hash.size() >= hashSize);
+        finalizeInto(hash.data());
+    }
+
+    /// Get hash without allocating memory.
+    std::array<uint8_t, hashSize> finalizeArray()
+    {
+        std::array<uint8_t, hashSize> r;
+        finalizeInto(r.data());
+        return r;
+    }
+
+    /// Export the hasher state (chaining state, buffered bytes and message length) as versioned blob (see Midstate.hpp).
+    /// Use importState() to continue hashing later, for example to hash a common prefix only once.
+    std::vector<uint8_t> exportState() const
+    {
+        return Midstate::store(Midstate::Algorithm::sha512, hashSize, messageLength, state, 8, buffer, messageLength & 0x7f);
+    }
+
+    /// Import a state exported by exportState().
+    /// Return false and leave the hasher unchanged if blob is not a valid SHA-512 state.
+    bool importState(std::span<const uint8_t> blob)
+    {
+        uint64_t s[8];
+        uint64_t length;
+        std::span<const uint8_t> buffered;
+        if (!Midstate::load(blob, Midstate::Algorithm::sha512, hashSize, length, s, 8, buffered) || (buffered.size() != (length & 0x7f)))
+        {
+            return false;
+        }
+        std::copy(s, s + 8, state);
+        std::copy(buffered.begin(), buffered.end(), buffer);
+        messageLength = length;
+        return true;
+    }
+
+    /// Calculate the hash of n bytes in one go and write it to hash (hashSize bytes).
+    /// Can be used in constant expressions.
+    /// Faster than update() and finalize() for short messages: There is no buffering and messages of up to 111 bytes need exactly one compression.
+    static constexpr void calcHash(const uint8_t *bytes, size_t n, uint8_t *hash)
+    {
+        uint64_t s[8];
+        std::copy(initialState, initialState + 8, s);
+        size_t numBlocks = n / 128;
+        processBlocks(s, bytes, numBlocks);
+
+        // Pad the remaining bytes on the stack.
+        alignas(8) uint8_t block[256];
+        std::copy(bytes + numBlocks * 128, bytes + n, block);
+        processBlocks(s, block, padMessage(block, n));
+        storeHash(s, hash);
+    }
+
+    /// Calculate the hashes of count independent messages (multi-buffer hashing).
+    /// The hash of messages[i] (lengths[i] bytes) is written to hashes + i * hashSize.
+    /// On CPUs with AVX2/AVX-512 4/8 messages are hashed in parallel in the lanes of the SIMD registers.
+    static void calcHashes(const uint8_t *const *messages, const size_t *lengths, size_t count, uint8_t *hashes)
+    {
+#ifdef LEANCRYPT_X86
+        const CpuFeatures &cpu = CpuFeatures::get();
+        if (cpu.avx512f)
+        {
+            multiBufferHash<MultiBufferTraits, 8>(processBlockLanesAvx512, messages, lengths, count, hashes);
+            return;
+        }
+        if (cpu.avx2)
+        {
+            multiBufferHash<MultiBufferTraits, 4>(processBlockLanesAvx2, messages, lengths, count, hashes);
+            return;
+        }
+#endif
+        for (size_t i = 0; i < count; i++)
+        {
+            calcHash(messages[i], lengths[i], hashes + i * hashSize);
+        }
+    }
+
+    /// Compression function interface (PBKDF2 iterates it directly on the HMAC key states).
+    /// The chaining state consists of stateWords words of type Word.
+    using Word = uint64_t;
+    static constexpr size_t stateWords = 8;
+
+    /// Copy the chaining state (stateWords words) to s.
+    /// Only valid at block boundaries, e.g. after the key block of HMAC.
+    void getChainingState(Word *s) const
+    {
+        assert(messageLength % blockSize == 0);
+        std::copy(state, state + stateWords, s);
+    }
+
+    /// Compress numBlocks whole blocks of data into the chaining state s.
+    static constexpr void compressBlocks(Word *s, const uint8_t *data, size_t numBlocks)
+    {
+        processBlocks(s, data, numBlocks);
+    }
+
+    /// Pad the last (messageLength % 128) message bytes in block (room for two blocks).
+    /// Return the number of blocks to process (1 or 2).
+    static constexpr size_t padMessage(uint8_t *block, size_t messageLength)
+    {
         size_t bufferedBytes = messageLength & 0x7f;
-        buffer[bufferedBytes] = 0x80;
-        memset(buffer + bufferedBytes + 1, 0, 128 - bufferedBytes - 1);
-        if (bufferedBytes + 17 > 128)
+        size_t numBlocks = (bufferedBytes + 17 > 128) ? 2 : 1;
+        block[bufferedBytes] = 0x80;
+        std::fill(block + bufferedBytes + 1, block + numBlocks * 128 - 16, 0);
+        // Message length in bits as big-endian 128-bit number.
+        uint64_t bitLength[2] = { uint64_t(messageLength) >> 61, uint64_t(messageLength) << 3 };
+        for (unsigned i = 0; i < 16; i++)
         {
-            processBlock(buffer);
-            memset(buffer, 0, 128 - 16);
+            block[numBlocks * 128 - 16 + i] = uint8_t(bitLength[i / 8] >> (56 - i % 8 * 8));
         }
-        uint64_t *buffer64 = reinterpret_cast<uint64_t *>(buffer);
-        buffer64[14] = byteSwap64LE(messageLength >> 61);
-        buffer64[15] = byteSwap64LE(messageLength << 3);
-        processBlock(buffer);
-
-        // Return hash.
-        std::vector<uint8_t> r(64);
-        uint64_t *data = reinterpret_cast<uint64_t *>(r.data());
+        return numBlocks;
+    }
+
+    /// Store state as big-endian hash.
+    static constexpr void storeHash(const uint64_t *state, uint8_t *hash)
+    {
         for (unsigned i = 0; i < 8; i++)
         {
-            *(data++) = byteSwap64LE(state[i]);
+            for (unsigned j = 0; j < 8; j++)
+            {
+                hash[i * 8 + j] = uint8_t(state[i] >> (56 - j * 8));
+            }
         }
-        clear();
-        return r;
     }
 
 private:
+    /// Write hash to hash (hashSize bytes) and clear hasher.
+    void finalizeInto(uint8_t *hash)
+    {
+        // Pad message and calc final 1-2 blocks.
+        alignas(8) uint8_t block[256];
+        std::copy(buffer, buffer + (messageLength & 0x7f), block);
+        processBlocks(block, padMessage(block, messageLength));
+
+        storeHash(state, hash);
+        clear();
+    }
+
     /// Reverse bytes in 64-bit word on little-endian machines.
-    uint64_t byteSwap64LE(uint64_t x)
+    static constexpr uint64_t byteSwap64LE(uint64_t x)
     {
 #ifdef __BIG_ENDIAN__
         return x;
@@ -98,16 +240,77 @@ private:
 #endif
     }
 
+    /// Load big-endian 64-bit word.
+    static constexpr uint64_t loadBE64(const uint8_t *data)
+    {
+        if consteval
+        {
+            uint64_t r = 0;
+            for (unsigned i = 0; i < 8; i++)
+            {
+                r = (r << 8) | data[i];
+            }
+            return r;
+        }
+        return byteSwap64LE(*reinterpret_cast<const uint64_t *>(data));
+    }
+
     /// Helper functions.
-    static uint64_t Sig0(uint64_t x) { return std::rotr(x, 28) ^ std::rotr(x, 34) ^ std::rotr(x, 39); }
-    static uint64_t Sig1(uint64_t x) { return std::rotr(x, 14) ^ std::rotr(x, 18) ^ std::rotr(x, 41); }
-    static uint64_t sig0(uint64_t x) { return std::rotr(x, 1) ^ std::rotr(x, 8) ^ (x >> 7); }
-    static uint64_t sig1(uint64_t x) { return std::rotr(x, 19) ^ std::rotr(x, 61) ^ (x >> 6); }
-    static uint64_t Ch(uint64_t x, uint64_t y, uint64_t z) { return (x & y) ^ ((~x) & z); }
-    static uint64_t Maj(uint64_t x, uint64_t y, uint64_t z) { return (x & y) ^ (x & z) ^ (y & z); }
+    static constexpr uint64_t Sig0(uint64_t x) { return std::rotr(x, 28) ^ std::rotr(x, 34) ^ std::rotr(x, 39); }
+    static constexpr uint64_t Sig1(uint64_t x) { return std::rotr(x, 14) ^ std::rotr(x, 18) ^ std::rotr(x, 41); }
+    static constexpr uint64_t sig0(uint64_t x) { return std::rotr(x, 1) ^ std::rotr(x, 8) ^ (x >> 7); }
+    static constexpr uint64_t sig1(uint64_t x) { return std::rotr(x, 19) ^ std::rotr(x, 61) ^ (x >> 6); }
+    static constexpr uint64_t Ch(uint64_t x, uint64_t y, uint64_t z) { return (x & y) ^ ((~x) & z); }
+    static constexpr uint64_t Maj(uint64_t x, uint64_t y, uint64_t z) { return (x & y) ^ (x & z) ^ (y & z); }
 
     /// Process block.
     void processBlock(const uint8_t *data)
+    {
+        processBlocks(data, 1);
+    }
+
+    /// Process whole blocks.
+    void processBlocks(const uint8_t *data, size_t numBlocks)
+    {
+        processBlocks(state, data, numBlocks);
+    }
+
+    /// Process whole blocks using the fastest implementation available on this CPU.
+    /// Uses the portable implementation during constant evaluation.
+    static constexpr void processBlocks(uint64_t *state, const uint8_t *data, size_t numBlocks)
+    {
+        if consteval
+        {
+            processBlocksPortable(state, data, numBlocks);
+            return;
+        }
+        using ProcessBlocksFunc = void (*)(uint64_t *state, const uint8_t *data, size_t numBlocks);
+        static const ProcessBlocksFunc processBlocksFunc = []() -> ProcessBlocksFunc
+        {
+#ifdef LEANCRYPT_X86
+            const CpuFeatures &cpu = CpuFeatures::get();
+            if (cpu.avx2 && cpu.bmi2)
+            {
+                return processBlocksAvx2;
+            }
+#endif
+            return processBlocksPortable;
+        }();
+        processBlocksFunc(state, data, numBlocks);
+    }
+
+    /// Process blocks (portable implementation).
+    static constexpr void processBlocksPortable(uint64_t *state, const uint8_t *data, size_t numBlocks)
+    {
+        for (; numBlocks > 0; numBlocks--)
+        {
+            processBlockPortable(state, data);
+            data += 128;
+        }
+    }
+
+    /// Process block (portable implementation).
+    static constexpr void processBlockPortable(uint64_t *state, const uint8_t *data)
     {
         uint64_t a = state[0];
         uint64_t b = state[1];
@@ -121,7 +324,7 @@ private:
         uint64_t W[16];
         for (unsigned t = 0; t < 16; t++)
         {
-            W[t] = byteSwap64LE(*reinterpret_cast<const uint64_t *>(data));
+            W[t] = loadBE64(data);
             data += 8;
             uint64_t T1 = h + Sig1(e) + Ch(e, f, g) + K512[t] + W[t];
             uint64_t T2 = Sig0(a) + Maj(a, b, c);
@@ -160,6 +363,160 @@ private:
         state[7] += h;
     }
 
+#ifdef LEANCRYPT_X86
+    /// sig0() and sig1() of two message words.
+    __attribute__((target("avx2,bmi2"))) static __m128i sig0x2(__m128i x) { return _mm_xor_si128(_mm_xor_si128(_mm_or_si128(_mm_srli_epi64(x, 1), _mm_slli_epi64(x, 63)), _mm_or_si128(_mm_srli_epi64(x, 8), _mm_slli_epi64(x, 56))), _mm_srli_epi64(x, 7)); }
+    __attribute__((target("avx2,bmi2"))) static __m128i sig1x2(__m128i x) { return _mm_xor_si128(_mm_xor_si128(_mm_or_si128(_mm_srli_epi64(x, 19), _mm_slli_epi64(x, 45)), _mm_or_si128(_mm_srli_epi64(x, 61), _mm_slli_epi64(x, 3))), _mm_srli_epi64(x, 6)); }
+
+    /// Calculate the next two message words W[t], W[t+1] into w0 (which holds W[t-16], W[t-15]) and store W + K to WK.
+    /// wN holds W[t-16+2N], W[t-15+2N].
+    __attribute__((target("avx2,bmi2"))) static void scheduleMessageX2(__m128i &w0, __m128i w1, __m128i w4, __m128i w5, __m128i w7, uint64_t *WK, unsigned t)
+    {
+        w0 = _mm_add_epi64(_mm_add_epi64(w0, sig0x2(_mm_alignr_epi8(w1, w0, 8))), _mm_add_epi64(_mm_alignr_epi8(w5, w4, 8), sig1x2(w7)));
+        _mm_store_si128(reinterpret_cast<__m128i *>(WK + t), _mm_add_epi64(w0, _mm_loadu_si128(reinterpret_cast<const __m128i *>(K512 + t))));
+    }
+
+    /// One round with precalculated W + K.
+    /// The caller rotates the roles of the state variables instead of moving the values.
+    static void round(uint64_t a, uint64_t b, uint64_t c, uint64_t &d, uint64_t e, uint64_t f, uint64_t g, uint64_t &h, uint64_t wk)
+    {
+        uint64_t T1 = h + Sig1(e) + Ch(e, f, g) + wk;
+        d += T1;
+        h = T1 + Sig0(a) + Maj(a, b, c);
+    }
+
+    /// Process blocks using AVX2 and BMI2.
+    /// The message schedule is calculated two words at a time in SIMD registers and W + K is precalculated for all 80 rounds.
+    /// The rounds use the BMI2 rorx instruction for the rotations of Sig0() and Sig1().
+    __attribute__((target("avx2,bmi2"))) static void processBlocksAvx2(uint64_t *state, const uint8_t *data, size_t numBlocks)
+    {
+        const __m128i byteSwapMask = _mm_set_epi64x(0x08090a0b0c0d0e0full, 0x0001020304050607ull);
+        alignas(16) uint64_t WK[80];
+        for (; numBlocks > 0; numBlocks--)
+        {
+            __m128i w[8];
+            for (unsigned i = 0; i < 8; i++)
+            {
+                w[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i * 16)), byteSwapMask);
+                _mm_store_si128(reinterpret_cast<__m128i *>(WK + i * 2), _mm_add_epi64(w[i], _mm_loadu_si128(reinterpret_cast<const __m128i *>(K512 + i * 2))));
+            }
+            __m128i w0 = w[0], w1 = w[1], w2 = w[2], w3 = w[3], w4 = w[4], w5 = w[5], w6 = w[6], w7 = w[7];
+            for (unsigned t = 16; t < 80; t += 16)
+            {
+                scheduleMessageX2(w0, w1, w4, w5, w7, WK, t);
+                scheduleMessageX2(w1, w2, w5, w6, w0, WK, t + 2);
+                scheduleMessageX2(w2, w3, w6, w7, w1, WK, t + 4);
+                scheduleMessageX2(w3, w4, w7, w0, w2, WK, t + 6);
+                scheduleMessageX2(w4, w5, w0, w1, w3, WK, t + 8);
+                scheduleMessageX2(w5, w6, w1, w2, w4, WK, t + 10);
+                scheduleMessageX2(w6, w7, w2, w3, w5, WK, t + 12);
+                scheduleMessageX2(w7, w0, w3, w4, w6, WK, t + 14);
+            }
+
+            uint64_t a = state[0];
+            uint64_t b = state[1];
+            uint64_t c = state[2];
+            uint64_t d = state[3];
+            uint64_t e = state[4];
+            uint64_t f = state[5];
+            uint64_t g = state[6];
+            uint64_t h = state[7];
+            for (unsigned t = 0; t < 80; t += 8)
+            {
+                round(a, b, c, d, e, f, g, h, WK[t]);
+                round(h, a, b, c, d, e, f, g, WK[t + 1]);
+                round(g, h, a, b, c, d, e, f, WK[t + 2]);
+                round(f, g, h, a, b, c, d, e, WK[t + 3]);
+                round(e, f, g, h, a, b, c, d, WK[t + 4]);
+                round(d, e, f, g, h, a, b, c, WK[t + 5]);
+                round(c, d, e, f, g, h, a, b, WK[t + 6]);
+                round(b, c, d, e, f, g, h, a, WK[t + 7]);
+            }
+            state[0] += a;
+            state[1] += b;
+            state[2] += c;
+            state[3] += d;
+            state[4] += e;
+            state[5] += f;
+            state[6] += g;
+            state[7] += h;
+            data += 128;
+        }
+    }
+
+    /// Process one block in each SIMD lane of V (multi-buffer implementation).
+    /// state is stored word-major: state[word * numLanes + lane].
+    /// Only pass vectors by pointer here: This is inlined into the target specific functions below.
+    template<class V>
+    __attribute__((always_inline)) static inline void processBlockLanes(uint64_t *state, const uint8_t *const *blocks)
+    {
+        constexpr unsigned numLanes = sizeof(V) / sizeof(uint64_t);
+#define HashSha512_ROTR(x, n) (((x) >> (n)) | ((x) << (64 - (n))))
+        V s[8];
+        memcpy(s, state, sizeof(s));
+        V a = s[0];
+        V b = s[1];
+        V c = s[2];
+        V d = s[3];
+        V e = s[4];
+        V f = s[5];
+        V g = s[6];
+        V h = s[7];
+
+        V W[16];
+        for (unsigned t = 0; t < 16; t++)
+        {
+            for (unsigned lane = 0; lane < numLanes; lane++)
+            {
+                W[t][lane] = byteSwap64LE(*reinterpret_cast<const uint64_t *>(blocks[lane] + t * 8));
+            }
+        }
+
+        for (unsigned t = 0; t < 80; t++)
+        {
+            if (t >= 16)
+            {
+                V w1 = W[(t + 1) & 0xf];
+                V w14 = W[(t + 14) & 0xf];
+                W[t & 0xf] += (HashSha512_ROTR(w1, 1) ^ HashSha512_ROTR(w1, 8) ^ (w1 >> 7)) + (HashSha512_ROTR(w14, 19) ^ HashSha512_ROTR(w14, 61) ^ (w14 >> 6)) + W[(t + 9) & 0xf];
+            }
+            V T1 = h + (HashSha512_ROTR(e, 14) ^ HashSha512_ROTR(e, 18) ^ HashSha512_ROTR(e, 41)) + ((e & f) ^ (~e & g)) + K512[t] + W[t & 0xf];
+            V T2 = (HashSha512_ROTR(a, 28) ^ HashSha512_ROTR(a, 34) ^ HashSha512_ROTR(a, 39)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + T1;
+            d = c;
+            c = b;
+            b = a;
+            a = T1 + T2;
+        }
+#undef HashSha512_ROTR
+
+        s[0] += a;
+        s[1] += b;
+        s[2] += c;
+        s[3] += d;
+        s[4] += e;
+        s[5] += f;
+        s[6] += g;
+        s[7] += h;
+        memcpy(state, s, sizeof(s));
+    }
+
+    /// Process 4 blocks in parallel using AVX2.
+    __attribute__((target("avx2"))) static void processBlockLanesAvx2(uint64_t *state, const uint8_t *const *blocks)
+    {
+        processBlockLanes<MultiBufferU64x4>(state, blocks);
+    }
+
+    /// Process 8 blocks in parallel using AVX-512.
+    __attribute__((target("avx512f"))) static void processBlockLanesAvx512(uint64_t *state, const uint8_t *const *blocks)
+    {
+        processBlockLanes<MultiBufferU64x8>(state, blocks);
+    }
+#endif
+
     static constexpr uint64_t K512[] = {
         0x428a2f98d728ae22, 0x7137449123ef65cd, 0xb5c0fbcfec4d3b2f, 0xe9b5dba58189dbbc,
         0x3956c25bf348b538, 0x59f111f1b605d019, 0x923f82a4af194f9b, 0xab1c5ed5da6d8118,
@@ -193,4 +550,16 @@ private:
 
     /// Message length in bytes.
     size_t messageLength;
+
+    /// Interface for multiBufferHash().
+    struct MultiBufferTraits
+    {
+        using Word = HashSha512::Word;
+        static constexpr size_t blockSize = HashSha512::blockSize;
+        static constexpr size_t stateWords = HashSha512::stateWords;
+        static constexpr size_t hashSize = HashSha512::hashSize;
+        static constexpr const uint64_t *initialState = HashSha512::initialState;
+        static size_t padMessage(uint8_t *block, size_t messageLength) { return HashSha512::padMessage(block, messageLength); }
+        static void storeHash(const uint64_t *state, uint8_t *hash) { HashSha512::storeHash(state, hash); }
+    };
 };
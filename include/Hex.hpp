@@ -0,0 +1,195 @@
+// Hex encoding and decoding.
+//
+// Copyright (c) 2026 Johannes Overmann
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <stdint.h>
+#include <array>
+#include <span>
+#include <string>
+#include "CpuFeatures.hpp"
+
+/// Hex encoding (lowercase) and decoding (case insensitive) without streams.
+/// Uses SSSE3/AVX2 for 16/32 bytes at a time if available.
+class Hex
+{
+public:
+    /// Encode n bytes into 2 * n hex digits.
+    static void encode(const uint8_t *bytes, size_t n, char *hex)
+    {
+        using EncodeFunc = void (*)(const uint8_t *bytes, size_t n, char *hex);
+        static const EncodeFunc encodeFunc = []() -> EncodeFunc
+        {
+#ifdef LEANCRYPT_X86
+            const CpuFeatures &cpu = CpuFeatures::get();
+            if (cpu.avx2)
+            {
+                return encodeAvx2;
+            }
+            if (cpu.ssse3)
+            {
+                return encodeSsse3;
+            }
+#endif
+            return encodePortable;
+        }();
+        encodeFunc(bytes, n, hex);
+    }
+
+    /// Encode bytes into a hex string.
+    static std::string encode(std::span<const uint8_t> bytes)
+    {
+        std::string r(bytes.size() * 2, '\0');
+        encode(bytes.data(), bytes.size(), r.data());
+        return r;
+    }
+
+    /// Decode 2 * n hex digits into n bytes.
+    /// Return false if hex contains a character which is not a hex digit (the contents of bytes is undefined then).
+    static bool decode(const char *hex, size_t n, uint8_t *bytes)
+    {
+        using DecodeFunc = bool (*)(const char *hex, size_t n, uint8_t *bytes);
+        static const DecodeFunc decodeFunc = []() -> DecodeFunc
+        {
+#ifdef LEANCRYPT_X86
+            const CpuFeatures &cpu = CpuFeatures::get();
+            if (cpu.avx2)
+            {
+                return decodeAvx2;
+            }
+            if (cpu.ssse3)
+            {
+                return decodeSsse3;
+            }
+#endif
+            return decodePortable;
+        }();
+        return decodeFunc(hex, n, bytes);
+    }
+
+    /// Encode n bytes into 2 * n hex digits (portable implementation).
+    static void encodePortable(const uint8_t *bytes, size_t n, char *hex)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            hex[i * 2] = digits[bytes[i] >> 4];
+            hex[i * 2 + 1] = digits[bytes[i] & 0xf];
+        }
+    }
+
+    /// Decode 2 * n hex digits into n bytes (portable implementation).
+    static bool decodePortable(const char *hex, size_t n, uint8_t *bytes)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            uint8_t hi = values[uint8_t(hex[i * 2])];
+            uint8_t lo = values[uint8_t(hex[i * 2 + 1])];
+            if ((hi | lo) & 0xf0)
+            {
+                return false;
+            }
+            bytes[i] = (hi << 4) | lo;
+        }
+        return true;
+    }
+
+private:
+#ifdef LEANCRYPT_X86
+    /// Encode 16 bytes at a time using SSSE3.
+    __attribute__((target("ssse3"))) static void encodeSsse3(const uint8_t *bytes, size_t n, char *hex)
+    {
+        const __m128i digitTable = _mm_loadu_si128(reinterpret_cast<const __m128i *>(digits));
+        const __m128i nibbleMask = _mm_set1_epi8(0x0f);
+        for (; n >= 16; n -= 16, bytes += 16, hex += 32)
+        {
+            __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes));
+            __m128i hi = _mm_shuffle_epi8(digitTable, _mm_and_si128(_mm_srli_epi16(x, 4), nibbleMask));
+            __m128i lo = _mm_shuffle_epi8(digitTable, _mm_and_si128(x, nibbleMask));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(hex), _mm_unpacklo_epi8(hi, lo));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(hex + 16), _mm_unpackhi_epi8(hi, lo));
+        }
+        encodePortable(bytes, n, hex);
+    }
+
+    /// Encode 32 bytes at a time using AVX2.
+    __attribute__((target("avx2"))) static void encodeAvx2(const uint8_t *bytes, size_t n, char *hex)
+    {
+        const __m256i digitTable = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(digits)));
+        const __m256i nibbleMask = _mm256_set1_epi8(0x0f);
+        for (; n >= 32; n -= 32, bytes += 32, hex += 64)
+        {
+            __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(bytes));
+            __m256i hi = _mm256_shuffle_epi8(digitTable, _mm256_and_si256(_mm256_srli_epi16(x, 4), nibbleMask));
+            __m256i lo = _mm256_shuffle_epi8(digitTable, _mm256_and_si256(x, nibbleMask));
+            // Unpack works within 128-bit lanes: Bytes 0-7 and 16-23 / 8-15 and 24-31.
+            __m256i a = _mm256_unpacklo_epi8(hi, lo);
+            __m256i b = _mm256_unpackhi_epi8(hi, lo);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(hex), _mm256_permute2x128_si256(a, b, 0x20));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(hex + 32), _mm256_permute2x128_si256(a, b, 0x31));
+        }
+        encodeSsse3(bytes, n, hex);
+    }
+
+    /// Decode 16 hex digits at a time using SSSE3.
+    __attribute__((target("ssse3"))) static bool decodeSsse3(const char *hex, size_t n, uint8_t *bytes)
+    {
+        for (; n >= 8; n -= 8, hex += 16, bytes += 8)
+        {
+            __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(hex));
+            __m128i lc = _mm_or_si128(c, _mm_set1_epi8(0x20));
+            // Characters >= 0x80 are negative and fail both range checks.
+            __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(c, _mm_set1_epi8('9' + 1)));
+            __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(lc, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(lc, _mm_set1_epi8('f' + 1)));
+            if (_mm_movemask_epi8(_mm_or_si128(digit, letter)) != 0xffff)
+            {
+                return false;
+            }
+            __m128i v = _mm_or_si128(_mm_and_si128(digit, _mm_sub_epi8(c, _mm_set1_epi8('0'))), _mm_and_si128(letter, _mm_sub_epi8(lc, _mm_set1_epi8('a' - 10))));
+            // Combine nibble pairs: 16 * v[2 * i] + v[2 * i + 1].
+            __m128i w = _mm_maddubs_epi16(v, _mm_set1_epi16(0x0110));
+            _mm_storel_epi64(reinterpret_cast<__m128i *>(bytes), _mm_packus_epi16(w, w));
+        }
+        return decodePortable(hex, n, bytes);
+    }
+
+    /// Decode 32 hex digits at a time using AVX2.
+    __attribute__((target("avx2"))) static bool decodeAvx2(const char *hex, size_t n, uint8_t *bytes)
+    {
+        for (; n >= 16; n -= 16, hex += 32, bytes += 16)
+        {
+            __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(hex));
+            __m256i lc = _mm256_or_si256(c, _mm256_set1_epi8(0x20));
+            __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('0' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), c));
+            __m256i letter = _mm256_and_si256(_mm256_cmpgt_epi8(lc, _mm256_set1_epi8('a' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('f' + 1), lc));
+            if (_mm256_movemask_epi8(_mm256_or_si256(digit, letter)) != -1)
+            {
+                return false;
+            }
+            __m256i v = _mm256_or_si256(_mm256_and_si256(digit, _mm256_sub_epi8(c, _mm256_set1_epi8('0'))), _mm256_and_si256(letter, _mm256_sub_epi8(lc, _mm256_set1_epi8('a' - 10))));
+            __m256i w = _mm256_maddubs_epi16(v, _mm256_set1_epi16(0x0110));
+            // Pack works within 128-bit lanes: Move the two 8 byte results together.
+            __m256i p = _mm256_permute4x64_epi64(_mm256_packus_epi16(w, w), 0x08);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(bytes), _mm256_castsi256_si128(p));
+        }
+        return decodeSsse3(hex, n, bytes);
+    }
+#endif
+
+    /// Hex digits.
+    static constexpr char digits[17] = "0123456789abcdef";
+
+    /// Value of each character or 0xff if the character is not a hex digit.
+    static constexpr std::array<uint8_t, 256> values = []()
+    {
+        std::array<uint8_t, 256> r{};
+        for (unsigned c = 0; c < 256; c++)
+        {
+            r[c] = ((c >= '0') && (c <= '9')) ? c - '0' : ((c >= 'a') && (c <= 'f')) ? c - 'a' + 10 : ((c >= 'A') && (c <= 'F')) ? c - 'A' + 10 : 0xff;
+        }
+        return r;
+    }();
+};
@@ -0,0 +1,158 @@
+// HMAC implementation.
+//
+// Copyright (c) 2026 Johannes Overmann
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <stdint.h>
+#include <array>
+#include <span>
+#include <cassert>
+#include <algorithm>
+#include "ConstantTime.hpp"
+#include "Hash.hpp"
+
+/// HMAC according to FIPS PUB 198-1 / RFC 2104 for all hash classes (HMAC-SHA3 uses the rate as block size).
+/// https://nvlpubs.nist.gov/nistpubs/FIPS/NIST.FIPS.198-1.pdf
+///
+/// The key blocks (key xor ipad and key xor opad) are compressed only once in the constructor.
+/// Each message then starts from copies of these two hasher states, so a short message costs two compressions instead of four.
+/// An Hmac object can be used for any number of messages with the same key.
+template<class HashClass>
+class Hmac
+{
+public:
+    /// MAC size in bytes.
+    static constexpr size_t macSize = HashClass::hashSize;
+
+    /// Block size of the underlying hash in bytes.
+    static constexpr size_t blockSize = HashClass::blockSize;
+
+    /// Precompute the inner and outer hasher states for key.
+    Hmac(const uint8_t *key, size_t keyLength)
+    {
+        // Keys longer than the block size are hashed first.
+        uint8_t block[blockSize] = {};
+        if (keyLength > blockSize)
+        {
+            calcHashInto<HashClass>(key, keyLength, block);
+        }
+        else
+        {
+            std::copy(key, key + keyLength, block);
+        }
+
+        for (size_t i = 0; i < blockSize; i++)
+        {
+            block[i] ^= 0x36;
+        }
+        inner.update(block, blockSize);
+        for (size_t i = 0; i < blockSize; i++)
+        {
+            block[i] ^= 0x36 ^ 0x5c;
+        }
+        outer.update(block, blockSize);
+        hasher = inner;
+
+        // Do not leave key material on the stack.
+        wipe(block, blockSize);
+    }
+
+    /// Precompute the inner and outer hasher states for key.
+    explicit Hmac(std::span<const uint8_t> key): Hmac(key.data(), key.size())
+    {
+    }
+
+    /// Start a new message (streaming interface).
+    /// This is only necessary to discard data passed to update(), finalize() starts a new message automatically.
+    void clear()
+    {
+        hasher = inner;
+    }
+
+    /// Add data (streaming interface).
+    void update(const uint8_t *bytes, size_t n)
+    {
+        hasher.update(bytes, n);
+    }
+
+    /// Write MAC of the data passed to update() to mac (macSize bytes) and start a new message.
+    void finalize(uint8_t *mac)
+    {
+        finalizeInner(hasher, mac);
+        hasher = inner;
+    }
+
+    /// Get MAC of the data passed to update() and start a new message.
+    std::array<uint8_t, macSize> finalizeArray()
+    {
+        std::array<uint8_t, macSize> r;
+        finalize(r.data());
+        return r;
+    }
+
+    /// Write MAC of n bytes to mac (macSize bytes).
+    /// Does not modify the streaming state, so this may be called concurrently from several threads.
+    void calcMac(const uint8_t *bytes, size_t n, uint8_t *mac) const
+    {
+        HashClass h = inner;
+        h.update(bytes, n);
+        finalizeInner(h, mac);
+    }
+
+    /// Get MAC of n bytes.
+    std::array<uint8_t, macSize> calcMac(const uint8_t *bytes, size_t n) const
+    {
+        std::array<uint8_t, macSize> r;
+        calcMac(bytes, n, r.data());
+        return r;
+    }
+
+    /// Get MAC of bytes.
+    std::array<uint8_t, macSize> calcMac(std::span<const uint8_t> bytes) const
+    {
+        return calcMac(bytes.data(), bytes.size());
+    }
+
+    /// Check mac of n bytes in constant time.
+    /// Return false if mac does not have macSize bytes.
+    bool verify(const uint8_t *bytes, size_t n, std::span<const uint8_t> mac) const
+    {
+        return (mac.size() == macSize) && equalConstantTime(calcMac(bytes, n).data(), mac.data(), macSize);
+    }
+
+    /// Get the hasher state after the inner key block (key xor ipad).
+    /// PBKDF2 continues from the key states.
+    const HashClass &getInnerHasher() const
+    {
+        return inner;
+    }
+
+    /// Get the hasher state after the outer key block (key xor opad).
+    const HashClass &getOuterHasher() const
+    {
+        return outer;
+    }
+
+private:
+    /// Finalize the inner hasher h and write the outer hash to mac.
+    void finalizeInner(HashClass &h, uint8_t *mac) const
+    {
+        std::array<uint8_t, macSize> innerHash = h.finalizeArray();
+        HashClass o = outer;
+        o.update(innerHash.data(), macSize);
+        o.finalize(std::span<uint8_t>(mac, macSize));
+    }
+
+    /// Hasher state after the inner key block (key xor ipad).
+    HashClass inner;
+
+    /// Hasher state after the outer key block (key xor opad).
+    HashClass outer;
+
+    /// Streaming state.
+    HashClass hasher;
+};
@@ -0,0 +1,111 @@
+// Multi-buffer hashing with Keccak-p[1600, 24] sponges.
+//
+// Copyright (c) 2026 Johannes Overmann
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <stdint.h>
+#include <cstring>
+#include "CpuFeatures.hpp"
+#include "KeccakP1600.hpp"
+#include "MultiBuffer.hpp"
+
+/// Hash many independent messages with the Keccak sponge in the SIMD lanes of one core (see multiBufferHash()).
+/// rate is the block size in bytes, domain the domain separation bits followed by the first bit of pad10*1 (0x06 for
+/// SHA-3, 0x1f for SHAKE) and outputSize the number of output bytes (at most rate, so the output is a single squeeze).
+/// Used by SHA-3 (HashSha3::calcHashes()) and by the SHAKE leaves of ParallelHash.
+template<size_t rate, uint8_t domain, size_t outputSize>
+class KeccakMultiBuffer
+{
+    static_assert((rate % 8 == 0) && (rate < 200) && (outputSize <= rate), "Invalid rate or output size");
+
+public:
+    /// Write the outputs of count messages (messages[i] with lengths[i] bytes) to outputs + i * outputSize using AVX2/AVX-512.
+    /// Return false without doing anything if the CPU supports neither, the caller then hashes the messages one by one.
+    static bool calcHashes(const uint8_t *const *messages, const size_t *lengths, size_t count, uint8_t *outputs)
+    {
+#ifdef LEANCRYPT_X86
+        const CpuFeatures &cpu = CpuFeatures::get();
+        if (cpu.avx512f)
+        {
+            multiBufferHash<Traits, 8>(absorbBlockLanesAvx512, messages, lengths, count, outputs);
+            return true;
+        }
+        if (cpu.avx2)
+        {
+            multiBufferHash<Traits, 4>(absorbBlockLanesAvx2, messages, lengths, count, outputs);
+            return true;
+        }
+#else
+        (void)messages;
+        (void)lengths;
+        (void)count;
+        (void)outputs;
+#endif
+        return false;
+    }
+
+private:
+#ifdef LEANCRYPT_X86
+    /// Absorb one block into each of the states in the SIMD lanes of V and permute them.
+    /// state is stored word-major: state[word * numLanes + lane].
+    /// Only pass vectors by pointer here: This is inlined into the target specific functions below.
+    template<class V>
+    __attribute__((always_inline)) static inline void absorbBlockLanes(uint64_t *state, const uint8_t *const *blocks)
+    {
+        constexpr unsigned numLanes = sizeof(V) / sizeof(uint64_t);
+        V s[25];
+        memcpy(s, state, sizeof(s));
+        for (unsigned i = 0; i < rate / 8; i++)
+        {
+            for (unsigned lane = 0; lane < numLanes; lane++)
+            {
+                s[i][lane] ^= *reinterpret_cast<const uint64_t *>(blocks[lane] + i * 8);
+            }
+        }
+        KeccakP1600<24>::permutePortable(s);
+        memcpy(state, s, sizeof(s));
+    }
+
+    /// Absorb 4 blocks in parallel using AVX2.
+    __attribute__((target("avx2"))) static void absorbBlockLanesAvx2(uint64_t *state, const uint8_t *const *blocks)
+    {
+        absorbBlockLanes<MultiBufferU64x4>(state, blocks);
+    }
+
+    /// Absorb 8 blocks in parallel using AVX-512.
+    __attribute__((target("avx512f"))) static void absorbBlockLanesAvx512(uint64_t *state, const uint8_t *const *blocks)
+    {
+        absorbBlockLanes<MultiBufferU64x8>(state, blocks);
+    }
+#endif
+
+    /// Interface for multiBufferHash().
+    struct Traits
+    {
+        using Word = uint64_t;
+        static constexpr size_t hashSize = outputSize;
+        static constexpr size_t blockSize = rate;
+        static constexpr size_t stateWords = 25;
+        static constexpr uint64_t initialState[25] = {};
+
+        /// Pad the last (messageLength % blockSize) message bytes in block.
+        /// The padding always fits into one block.
+        static size_t padMessage(uint8_t *block, size_t messageLength)
+        {
+            size_t bufferedBytes = messageLength % blockSize;
+            block[bufferedBytes] = domain;
+            memset(block + bufferedBytes + 1, 0, blockSize - bufferedBytes - 1);
+            block[blockSize - 1] |= 0x80;
+            return 1;
+        }
+
+        static void storeHash(const uint64_t *state, uint8_t *hash)
+        {
+            memcpy(hash, state, hashSize);
+        }
+    };
+};
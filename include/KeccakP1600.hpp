@@ -0,0 +1,200 @@
+// Keccak-p[1600, n_r] permutation.
+//
+// Copyright (c) 2026 Johannes Overmann
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <stdint.h>
+#include "CpuFeatures.hpp"
+
+/// Keccak-p[1600, numRounds] permutation according to FIPS PUB 202 section 3.3.
+/// https://nvlpubs.nist.gov/nistpubs/FIPS/NIST.FIPS.202.pdf
+/// KeccakP1600<24> is Keccak-f[1600] (SHA-3, SHAKE), KeccakP1600<12> is used by TurboSHAKE and KangarooTwelve.
+/// Reduced round versions use the last numRounds rounds of Keccak-f[1600].
+template<unsigned numRounds = 24>
+class KeccakP1600
+{
+    static_assert((numRounds >= 1) && (numRounds <= 24), "Keccak-p[1600] supports 1 to 24 rounds");
+
+public:
+    /// Permute state (25 lanes in the order of FIPS PUB 202) using the fastest implementation available on this CPU.
+    /// Uses the portable implementation during constant evaluation.
+    static constexpr void permute(uint64_t *state)
+    {
+        if consteval
+        {
+            permutePortable(state);
+            return;
+        }
+        using PermuteFunc = void (*)(uint64_t *state);
+        static const PermuteFunc permuteFunc = []() -> PermuteFunc
+        {
+#ifdef LEANCRYPT_X86
+            if (CpuFeatures::get().avx512f)
+            {
+                return permuteAvx512;
+            }
+#endif
+            return permutePortable<uint64_t>;
+        }();
+        permuteFunc(state);
+    }
+
+    /// Permute state (portable implementation).
+    /// T is either uint64_t or a SIMD vector of uint64_t (several states in parallel, multi-buffer implementation).
+    ///
+    /// The state is kept in 25 local variables and the rounds are fully unrolled, so that the compiler can keep
+    /// the state in registers. Lanes 1, 2, 8, 12, 17 and 20 are complemented during the permutation (lane
+    /// complementing transform), which replaces most of the NOT operations in chi by OR operations.
+    template<class T>
+    static constexpr LEANCRYPT_FORCE_INLINE void permutePortable(T *state)
+    {
+#define KeccakP1600_ROTL(x, n) (((x) << (n)) | ((x) >> (64 - (n))))
+#define KeccakP1600_ROUND(a, e, round) \
+        /* Theta. */ \
+        c0 = a##0 ^ a##5 ^ a##10 ^ a##15 ^ a##20; \
+        c1 = a##1 ^ a##6 ^ a##11 ^ a##16 ^ a##21; \
+        c2 = a##2 ^ a##7 ^ a##12 ^ a##17 ^ a##22; \
+        c3 = a##3 ^ a##8 ^ a##13 ^ a##18 ^ a##23; \
+        c4 = a##4 ^ a##9 ^ a##14 ^ a##19 ^ a##24; \
+        d0 = c4 ^ KeccakP1600_ROTL(c1, 1); d1 = c0 ^ KeccakP1600_ROTL(c2, 1); d2 = c1 ^ KeccakP1600_ROTL(c3, 1); \
+        d3 = c2 ^ KeccakP1600_ROTL(c4, 1); d4 = c3 ^ KeccakP1600_ROTL(c0, 1); \
+        /* Rho, pi and chi (row by row). */ \
+        b0 = a##0 ^ d0; b1 = KeccakP1600_ROTL(a##6 ^ d1, 44); b2 = KeccakP1600_ROTL(a##12 ^ d2, 43); \
+        b3 = KeccakP1600_ROTL(a##18 ^ d3, 21); b4 = KeccakP1600_ROTL(a##24 ^ d4, 14); \
+        e##0 = b0 ^ (b1 | b2); e##1 = b1 ^ (~b2 | b3); e##2 = b2 ^ (b3 & b4); e##3 = b3 ^ (b4 | b0); e##4 = b4 ^ (b0 & b1); \
+        b0 = KeccakP1600_ROTL(a##3 ^ d3, 28); b1 = KeccakP1600_ROTL(a##9 ^ d4, 20); b2 = KeccakP1600_ROTL(a##10 ^ d0, 3); \
+        b3 = KeccakP1600_ROTL(a##16 ^ d1, 45); b4 = KeccakP1600_ROTL(a##22 ^ d2, 61); \
+        e##5 = b0 ^ (b1 | b2); e##6 = b1 ^ (b2 & b3); e##7 = b2 ^ (b3 | ~b4); e##8 = b3 ^ (b4 | b0); e##9 = b4 ^ (b0 & b1); \
+        b0 = KeccakP1600_ROTL(a##1 ^ d1, 1); b1 = KeccakP1600_ROTL(a##7 ^ d2, 6); b2 = KeccakP1600_ROTL(a##13 ^ d3, 25); \
+        b3 = KeccakP1600_ROTL(a##19 ^ d4, 8); b4 = KeccakP1600_ROTL(a##20 ^ d0, 18); \
+        e##10 = b0 ^ (b1 | b2); e##11 = b1 ^ (b2 & b3); e##12 = b2 ^ (~b3 & b4); e##13 = ~b3 ^ (b4 | b0); e##14 = b4 ^ (b0 & b1); \
+        b0 = KeccakP1600_ROTL(a##4 ^ d4, 27); b1 = KeccakP1600_ROTL(a##5 ^ d0, 36); b2 = KeccakP1600_ROTL(a##11 ^ d1, 10); \
+        b3 = KeccakP1600_ROTL(a##17 ^ d2, 15); b4 = KeccakP1600_ROTL(a##23 ^ d3, 56); \
+        e##15 = b0 ^ (b1 & b2); e##16 = b1 ^ (b2 | b3); e##17 = b2 ^ (~b3 | b4); e##18 = ~b3 ^ (b4 & b0); e##19 = b4 ^ (b0 | b1); \
+        b0 = KeccakP1600_ROTL(a##2 ^ d2, 62); b1 = KeccakP1600_ROTL(a##8 ^ d3, 55); b2 = KeccakP1600_ROTL(a##14 ^ d4, 39); \
+        b3 = KeccakP1600_ROTL(a##15 ^ d0, 41); b4 = KeccakP1600_ROTL(a##21 ^ d1, 2); \
+        e##20 = b0 ^ (~b1 & b2); e##21 = ~b1 ^ (b2 | b3); e##22 = b2 ^ (b3 & b4); e##23 = b3 ^ (b4 | b0); e##24 = b4 ^ (b0 & b1); \
+        /* Iota. */ \
+        e##0 ^= iota[round];
+        T a0 = state[0], a1 = ~state[1], a2 = ~state[2], a3 = state[3], a4 = state[4];
+        T a5 = state[5], a6 = state[6], a7 = state[7], a8 = ~state[8], a9 = state[9];
+        T a10 = state[10], a11 = state[11], a12 = ~state[12], a13 = state[13], a14 = state[14];
+        T a15 = state[15], a16 = state[16], a17 = ~state[17], a18 = state[18], a19 = state[19];
+        T a20 = ~state[20], a21 = state[21], a22 = state[22], a23 = state[23], a24 = state[24];
+        T e0, e1, e2, e3, e4, e5, e6, e7, e8, e9, e10, e11, e12, e13, e14, e15, e16, e17, e18, e19, e20, e21, e22, e23, e24;
+        T b0, b1, b2, b3, b4, c0, c1, c2, c3, c4, d0, d1, d2, d3, d4;
+        unsigned round = firstRound;
+        if constexpr ((numRounds % 2) != 0)
+        {
+            KeccakP1600_ROUND(a, e, round)
+            a0 = e0; a1 = e1; a2 = e2; a3 = e3; a4 = e4; a5 = e5; a6 = e6; a7 = e7; a8 = e8; a9 = e9;
+            a10 = e10; a11 = e11; a12 = e12; a13 = e13; a14 = e14; a15 = e15; a16 = e16; a17 = e17; a18 = e18; a19 = e19;
+            a20 = e20; a21 = e21; a22 = e22; a23 = e23; a24 = e24;
+            round++;
+        }
+        for (; round < 24; round += 2)
+        {
+            KeccakP1600_ROUND(a, e, round)
+            KeccakP1600_ROUND(e, a, round + 1)
+        }
+        state[0] = a0; state[1] = ~a1; state[2] = ~a2; state[3] = a3; state[4] = a4;
+        state[5] = a5; state[6] = a6; state[7] = a7; state[8] = ~a8; state[9] = a9;
+        state[10] = a10; state[11] = a11; state[12] = ~a12; state[13] = a13; state[14] = a14;
+        state[15] = a15; state[16] = a16; state[17] = ~a17; state[18] = a18; state[19] = a19;
+        state[20] = ~a20; state[21] = a21; state[22] = a22; state[23] = a23; state[24] = a24;
+#undef KeccakP1600_ROTL
+#undef KeccakP1600_ROUND
+    }
+
+#ifdef LEANCRYPT_X86
+    /// Permute state using AVX-512.
+    /// Each row of the state (5 lanes) is kept in the lower 320 bits of one ZMM register.
+    /// Theta and chi use vpternlogq, rho uses vprolvq and pi is a transpose done with lane permutes.
+    __attribute__((target("avx512f"))) static void permuteAvx512(uint64_t *state)
+    {
+        // Lane x of each row vector: Column x - 1, x + 1 and x + 2 (theta and chi).
+        const __m512i xm1 = _mm512_setr_epi64(4, 0, 1, 2, 3, 0, 0, 0);
+        const __m512i xp1 = _mm512_setr_epi64(1, 2, 3, 4, 0, 0, 0, 0);
+        const __m512i xp2 = _mm512_setr_epi64(2, 3, 4, 0, 1, 0, 0, 0);
+        // Rho rotation for row y.
+        const __m512i rho0 = _mm512_setr_epi64( 0,  1, 62, 28, 27, 0, 0, 0);
+        const __m512i rho1 = _mm512_setr_epi64(36, 44,  6, 55, 20, 0, 0, 0);
+        const __m512i rho2 = _mm512_setr_epi64( 3, 10, 43, 25, 39, 0, 0, 0);
+        const __m512i rho3 = _mm512_setr_epi64(41, 45, 15, 21,  8, 0, 0, 0);
+        const __m512i rho4 = _mm512_setr_epi64(18,  2, 61, 56, 14, 0, 0, 0);
+        // Pi: Lane x of row y is taken from lane (x + 3 * y) % 5 of row x.
+        // Bit 3 selects the second source of vpermt2q for the odd rows.
+        const __m512i pi0 = _mm512_setr_epi64(0,  9, 2, 11, 4, 0, 0, 0);
+        const __m512i pi1 = _mm512_setr_epi64(3, 12, 0,  9, 2, 0, 0, 0);
+        const __m512i pi2 = _mm512_setr_epi64(1, 10, 3, 12, 0, 0, 0, 0);
+        const __m512i pi3 = _mm512_setr_epi64(4,  8, 1, 10, 3, 0, 0, 0);
+        const __m512i pi4 = _mm512_setr_epi64(2, 11, 4,  8, 1, 0, 0, 0);
+
+        __m512i a0 = _mm512_maskz_loadu_epi64(0x1f, state);
+        __m512i a1 = _mm512_maskz_loadu_epi64(0x1f, state + 5);
+        __m512i a2 = _mm512_maskz_loadu_epi64(0x1f, state + 10);
+        __m512i a3 = _mm512_maskz_loadu_epi64(0x1f, state + 15);
+        __m512i a4 = _mm512_maskz_loadu_epi64(0x1f, state + 20);
+
+#define KeccakP1600_XOR3(a, b, c) _mm512_ternarylogic_epi64(a, b, c, 0x96)
+#define KeccakP1600_PI(pi) _mm512_mask_permutexvar_epi64(_mm512_mask_blend_epi64(0x0c, _mm512_permutex2var_epi64(a0, pi, a1), _mm512_permutex2var_epi64(a2, pi, a3)), 0x10, pi, a4)
+#define KeccakP1600_CHI(a) _mm512_ternarylogic_epi64(a, _mm512_maskz_permutexvar_epi64(0x1f, xp1, a), _mm512_maskz_permutexvar_epi64(0x1f, xp2, a), 0xd2)
+        for (unsigned round = firstRound; round < 24; round++)
+        {
+            // Theta.
+            __m512i c = KeccakP1600_XOR3(KeccakP1600_XOR3(a0, a1, a2), a3, a4);
+            __m512i d0 = _mm512_maskz_permutexvar_epi64(0x1f, xm1, c);
+            __m512i d1 = _mm512_maskz_rol_epi64(0x1f, _mm512_maskz_permutexvar_epi64(0x1f, xp1, c), 1);
+
+            // Rho.
+            a0 = _mm512_maskz_rolv_epi64(0x1f, KeccakP1600_XOR3(a0, d0, d1), rho0);
+            a1 = _mm512_maskz_rolv_epi64(0x1f, KeccakP1600_XOR3(a1, d0, d1), rho1);
+            a2 = _mm512_maskz_rolv_epi64(0x1f, KeccakP1600_XOR3(a2, d0, d1), rho2);
+            a3 = _mm512_maskz_rolv_epi64(0x1f, KeccakP1600_XOR3(a3, d0, d1), rho3);
+            a4 = _mm512_maskz_rolv_epi64(0x1f, KeccakP1600_XOR3(a4, d0, d1), rho4);
+
+            // Pi.
+            __m512i b0 = KeccakP1600_PI(pi0);
+            __m512i b1 = KeccakP1600_PI(pi1);
+            __m512i b2 = KeccakP1600_PI(pi2);
+            __m512i b3 = KeccakP1600_PI(pi3);
+            __m512i b4 = KeccakP1600_PI(pi4);
+
+            // Chi and iota.
+            a0 = _mm512_xor_si512(KeccakP1600_CHI(b0), _mm512_maskz_set1_epi64(1, iota[round]));
+            a1 = KeccakP1600_CHI(b1);
+            a2 = KeccakP1600_CHI(b2);
+            a3 = KeccakP1600_CHI(b3);
+            a4 = KeccakP1600_CHI(b4);
+        }
+#undef KeccakP1600_XOR3
+#undef KeccakP1600_PI
+#undef KeccakP1600_CHI
+
+        _mm512_mask_storeu_epi64(state, 0x1f, a0);
+        _mm512_mask_storeu_epi64(state + 5, 0x1f, a1);
+        _mm512_mask_storeu_epi64(state + 10, 0x1f, a2);
+        _mm512_mask_storeu_epi64(state + 15, 0x1f, a3);
+        _mm512_mask_storeu_epi64(state + 20, 0x1f, a4);
+    }
+#endif
+
+private:
+    /// Index of the first round (iota constant) of Keccak-p[1600, numRounds].
+    static constexpr unsigned firstRound = 24 - numRounds;
+
+    /// Iota constants.
+    static constexpr uint64_t iota[24] =
+    {
+        0x0000000000000001, 0x0000000000008082, 0x800000000000808a, 0x8000000080008000,
+        0x000000000000808b, 0x0000000080000001, 0x8000000080008081, 0x8000000000008009,
+        0x000000000000008a, 0x0000000000000088, 0x0000000080008009, 0x000000008000000a,
+        0x000000008000808b, 0x800000000000008b, 0x8000000000008089, 0x8000000000008003,
+        0x8000000000008002, 0x8000000000000080, 0x000000000000800a, 0x800000008000000a,
+        0x8000000080008081, 0x8000000000008080, 0x0000000080000001, 0x8000000080008008
+    };
+};
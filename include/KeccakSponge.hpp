@@ -0,0 +1,155 @@
+// Keccak sponge construction.
+//
+// Copyright (c) 2026 Johannes Overmann
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include "KeccakP1600.hpp"
+
+/// Sponge construction on Keccak-p[1600, numRounds] according to FIPS PUB 202 section 4 with rate bytes per block.
+/// Absorb data, pad once with a domain separation byte and then squeeze any number of output bytes.
+/// Building block for SHA-3 and the extendable-output functions (SHAKE, cSHAKE, KMAC, ParallelHash).
+template<size_t rate, unsigned numRounds = 24>
+class KeccakSponge
+{
+    static_assert((rate > 0) && (rate < 200) && (rate % 8 == 0), "Invalid rate");
+
+public:
+    /// Block size (rate) in bytes.
+    static constexpr size_t blockSize = rate;
+
+    KeccakSponge()
+    {
+        clear();
+    }
+
+    /// Initialize sponge (zero state, absorbing).
+    void clear()
+    {
+        std::fill(state, state + 25, 0);
+        pos = 0;
+        squeezing = false;
+    }
+
+    /// Absorb data.
+    void absorb(const uint8_t *bytes, size_t n)
+    {
+        assert(!squeezing);
+        uint8_t *state8 = reinterpret_cast<uint8_t *>(state);
+        if (pos > 0)
+        {
+            size_t num = std::min(n, rate - pos);
+            for (size_t i = 0; i < num; i++)
+            {
+                state8[pos + i] ^= bytes[i];
+            }
+            pos += num;
+            bytes += num;
+            n -= num;
+            if (pos < rate)
+            {
+                return;
+            }
+            KeccakP1600<numRounds>::permute(state);
+            pos = 0;
+        }
+
+        // Absorb whole blocks directly from the input.
+        for (; n >= rate; bytes += rate, n -= rate)
+        {
+            absorbBlock(state, bytes);
+        }
+
+        for (size_t i = 0; i < n; i++)
+        {
+            state8[i] ^= bytes[i];
+        }
+        pos = n;
+    }
+
+    /// Number of bytes absorbed into the current block.
+    size_t getBlockPos() const
+    {
+        return pos;
+    }
+
+    /// Pad with the domain separation bits and the final bit of pad10*1 and switch to squeezing.
+    /// domain contains the domain separation bits followed by the first bit of pad10*1 (e.g. 0x06 for SHA-3, 0x1f for SHAKE).
+    void pad(uint8_t domain)
+    {
+        assert(!squeezing);
+        uint8_t *state8 = reinterpret_cast<uint8_t *>(state);
+        state8[pos] ^= domain;
+        state8[rate - 1] ^= 0x80;
+        KeccakP1600<numRounds>::permute(state);
+        pos = 0;
+        squeezing = true;
+    }
+
+    /// Return true after pad().
+    bool isSqueezing() const
+    {
+        return squeezing;
+    }
+
+    /// Write the next n output bytes to output.
+    /// Whole blocks are copied directly from the state into output.
+    void squeeze(uint8_t *output, size_t n)
+    {
+        assert(squeezing);
+        const uint8_t *state8 = reinterpret_cast<const uint8_t *>(state);
+        while (n > 0)
+        {
+            if (pos == rate)
+            {
+                KeccakP1600<numRounds>::permute(state);
+                pos = 0;
+            }
+            size_t num = std::min(n, rate - pos);
+            memcpy(output, state8 + pos, num);
+            pos += num;
+            output += num;
+            n -= num;
+        }
+    }
+
+    /// Xor one block of data into state and permute state.
+    /// Can be used in constant expressions (e.g. for one-shot hashing on a state on the stack).
+    static constexpr void absorbBlock(uint64_t *state, const uint8_t *data)
+    {
+        for (size_t i = 0; i < rate / 8; i++)
+        {
+            uint64_t word = 0;
+            if consteval
+            {
+                for (unsigned j = 0; j < 8; j++)
+                {
+                    word |= uint64_t(data[i * 8 + j]) << (j * 8);
+                }
+            }
+            else
+            {
+                memcpy(&word, data + i * 8, 8);
+            }
+            state[i] ^= word;
+        }
+        KeccakP1600<numRounds>::permute(state);
+    }
+
+protected:
+    /// State.
+    uint64_t state[25];
+
+    /// Byte position in the current block (absorbing) or in the current output block (squeezing).
+    size_t pos;
+
+    /// Padded and squeezing.
+    bool squeezing;
+};
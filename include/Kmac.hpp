@@ -0,0 +1,133 @@
+// KMAC message authentication codes.
+//
+// Copyright (c) 2026 Johannes Overmann
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <stdint.h>
+#include <span>
+#include <vector>
+#include "ConstantTime.hpp"
+#include "CShake.hpp"
+
+/// KMAC128, KMAC256 and KMACXOF128, KMACXOF256 according to NIST SP 800-185 section 4.
+/// https://nvlpubs.nist.gov/nistpubs/SpecialPublications/NIST.SP.800-185.pdf
+/// Please use class Kmac128 or Kmac256 (see bottom of file).
+///
+/// The key prefix bytepad(encode_string("KMAC") || encode_string(S)) || bytepad(encode_string(K)) (at least two
+/// Keccak permutations) is absorbed once in the constructor. Each message then starts from a copy of this state.
+template<size_t securityBits>
+class Kmac
+{
+public:
+    /// Block size (rate) in bytes.
+    static constexpr size_t blockSize = CShake<securityBits>::blockSize;
+
+    /// Minimum MAC length in bytes accepted by verify() (SP 800-185 section 8.4.2: At least 64 bits without risk analysis).
+    static constexpr size_t minMacLength = 8;
+
+    /// Absorb the key prefix for key and customization string.
+    Kmac(const uint8_t *key, size_t keyLength, std::span<const uint8_t> customization = {}): prefix("KMAC", customization)
+    {
+        prefix.updateLeftEncoded(blockSize);
+        prefix.updateEncodedString(std::span<const uint8_t>(key, keyLength));
+        prefix.padBlock();
+        clear();
+    }
+
+    /// Absorb the key prefix for key and customization string.
+    explicit Kmac(std::span<const uint8_t> key, std::span<const uint8_t> customization = {}): Kmac(key.data(), key.size(), customization)
+    {
+    }
+
+    /// Start a new message from the key prefix.
+    void clear()
+    {
+        xof = prefix;
+        squeezing = false;
+    }
+
+    /// Add data.
+    /// Must not be called after squeeze() (without clear()).
+    void update(const uint8_t *bytes, size_t n)
+    {
+        xof.update(bytes, n);
+    }
+
+    /// Fixed length mode (KMAC): Write the MAC of length mac.size() to mac and start a new message.
+    /// The output length is part of the input, so a shorter MAC is not a prefix of a longer one.
+    void finalize(std::span<uint8_t> mac)
+    {
+        xof.updateRightEncoded(uint64_t(mac.size()) * 8);
+        xof.squeeze(mac);
+        clear();
+    }
+
+    /// XOF mode (KMACXOF): Write the next output.size() output bytes to output.
+    /// The first call finishes the input. Subsequent calls continue the output stream. Call clear() to start a new message.
+    void squeeze(std::span<uint8_t> output)
+    {
+        if (!squeezing)
+        {
+            xof.updateRightEncoded(0);
+            squeezing = true;
+        }
+        xof.squeeze(output);
+    }
+
+    /// Write the MAC of length mac.size() of n bytes to mac (fixed length mode).
+    /// Does not modify the streaming state, so this may be called concurrently from several threads.
+    void calcMac(const uint8_t *bytes, size_t n, std::span<uint8_t> mac) const
+    {
+        CShake<securityBits> x = prefix;
+        x.update(bytes, n);
+        x.updateRightEncoded(uint64_t(mac.size()) * 8);
+        x.squeeze(mac);
+    }
+
+    /// Get the MAC of length macLength of n bytes (fixed length mode).
+    std::vector<uint8_t> calcMac(const uint8_t *bytes, size_t n, size_t macLength) const
+    {
+        std::vector<uint8_t> r(macLength);
+        calcMac(bytes, n, r);
+        return r;
+    }
+
+    /// Check mac of n bytes in constant time (fixed length mode).
+    /// The MAC length is part of the KMAC input, so the caller has to pass the expected length macLength: Return false if
+    /// mac.size() differs from macLength or if macLength is shorter than minMacLength.
+    bool verify(const uint8_t *bytes, size_t n, std::span<const uint8_t> mac, size_t macLength) const
+    {
+        if ((macLength < minMacLength) || (mac.size() != macLength))
+        {
+            return false;
+        }
+        return equalConstantTime(calcMac(bytes, n, macLength).data(), mac.data(), macLength);
+    }
+
+private:
+    /// State after the key prefix.
+    CShake<securityBits> prefix;
+
+    /// Streaming state.
+    CShake<securityBits> xof;
+
+    /// Input finished in XOF mode.
+    bool squeezing;
+};
+
+/// KMAC variants.
+class Kmac128: public Kmac<128>
+{
+public:
+    using Kmac<128>::Kmac;
+};
+
+class Kmac256: public Kmac<256>
+{
+public:
+    using Kmac<256>::Kmac;
+};
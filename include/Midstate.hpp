@@ -0,0 +1,100 @@
+// Serialization of hasher states (midstates).
+//
+// Copyright (c) 2026 Johannes Overmann
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <stdint.h>
+#include <span>
+#include <vector>
+
+/// Versioned byte blob of a hasher state as used by exportState() and importState() of the hash classes.
+/// Layout (all integers little endian):
+/// - version (1 byte)
+/// - algorithm (1 byte)
+/// - hash size in bytes (1 byte)
+/// - message length in bytes or byte position in the block (8 bytes)
+/// - state words (4 or 8 bytes each)
+/// - buffered bytes of the current block
+class Midstate
+{
+public:
+    /// Blob format version.
+    static constexpr uint8_t version = 1;
+
+    /// Algorithm identifier.
+    enum class Algorithm: uint8_t
+    {
+        md5 = 1,
+        sha1 = 2,
+        sha256 = 3,
+        sha512 = 4,
+        sha3 = 5
+    };
+
+    /// Size of version, algorithm, hash size and length.
+    static constexpr size_t headerSize = 11;
+
+    /// Serialize a hasher state.
+    template<class Word>
+    static std::vector<uint8_t> store(Algorithm algorithm, size_t hashSize, uint64_t length, const Word *state, size_t numWords, const uint8_t *buffer, size_t bufferSize)
+    {
+        std::vector<uint8_t> r;
+        r.reserve(headerSize + numWords * sizeof(Word) + bufferSize);
+        r.push_back(version);
+        r.push_back(uint8_t(algorithm));
+        r.push_back(uint8_t(hashSize));
+        storeLE(r, length, 8);
+        for (size_t i = 0; i < numWords; i++)
+        {
+            storeLE(r, state[i], sizeof(Word));
+        }
+        r.insert(r.end(), buffer, buffer + bufferSize);
+        return r;
+    }
+
+    /// Deserialize a hasher state.
+    /// On success state (numWords) and length are set and buffer refers to the buffered bytes at the end of blob.
+    /// Return false if blob was not stored with this version, algorithm, hash size and number of state words.
+    /// The caller has to check the number of buffered bytes.
+    template<class Word>
+    static bool load(std::span<const uint8_t> blob, Algorithm algorithm, size_t hashSize, uint64_t &length, Word *state, size_t numWords, std::span<const uint8_t> &buffer)
+    {
+        size_t stateSize = numWords * sizeof(Word);
+        if ((blob.size() < headerSize + stateSize) || (blob[0] != version) || (blob[1] != uint8_t(algorithm)) || (blob[2] != hashSize))
+        {
+            return false;
+        }
+        length = loadLE(blob.data() + 3, 8);
+        for (size_t i = 0; i < numWords; i++)
+        {
+            state[i] = Word(loadLE(blob.data() + headerSize + i * sizeof(Word), sizeof(Word)));
+        }
+        buffer = blob.subspan(headerSize + stateSize);
+        return true;
+    }
+
+private:
+    /// Append the lower n bytes of x in little endian byte order.
+    static void storeLE(std::vector<uint8_t> &blob, uint64_t x, size_t n)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            blob.push_back(uint8_t(x >> (i * 8)));
+        }
+    }
+
+    /// Load n bytes in little endian byte order.
+    static uint64_t loadLE(const uint8_t *bytes, size_t n)
+    {
+        uint64_t r = 0;
+        for (size_t i = 0; i < n; i++)
+        {
+            r |= uint64_t(bytes[i]) << (i * 8);
+        }
+        return r;
+    }
+};
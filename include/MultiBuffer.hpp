@@ -0,0 +1,142 @@
+// Multi-buffer hashing: Hash many independent messages in the SIMD lanes of one core.
+//
+// Copyright (c) 2026 Johannes Overmann
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <cstring>
+#include "CpuFeatures.hpp"
+
+#ifdef LEANCRYPT_X86
+/// SIMD vector types for the multi-buffer block functions (GCC/Clang vector extensions).
+/// Only use these in functions which are compiled for the matching target (e.g. __attribute__((target("avx2")))).
+typedef uint32_t MultiBufferU32x8 __attribute__((vector_size(32)));
+typedef uint32_t MultiBufferU32x16 __attribute__((vector_size(64)));
+typedef uint64_t MultiBufferU64x4 __attribute__((vector_size(32)));
+typedef uint64_t MultiBufferU64x8 __attribute__((vector_size(64)));
+#endif
+
+/// Calculate the hashes of count independent messages using a multi-buffer block function.
+///
+/// processBlocks() processes one block in each of the numLanes lanes. The state is stored
+/// word-major: state[word * numLanes + lane].
+///
+/// Each lane hashes one message at a time. When a lane has processed the last padded block of its
+/// message the hash is written to hashes + message * Traits::hashSize and the lane is refilled with
+/// the next pending message (lane retirement). This way messages of different lengths never wait
+/// for each other. Idle lanes process a zero block and their result is ignored.
+///
+/// Traits must provide:
+/// - Word, blockSize, stateWords, hashSize and initialState[stateWords].
+/// - size_t padMessage(uint8_t *block, size_t messageLength): Pad the last (messageLength % blockSize)
+///   message bytes in block (room for two blocks) and return the number of blocks to process.
+/// - void storeHash(const Word *state, uint8_t *hash): Convert state into hash.
+template<class Traits, size_t numLanes>
+void multiBufferHash(void (*processBlocks)(typename Traits::Word *state, const uint8_t *const *blocks), const uint8_t *const *messages, const size_t *lengths, size_t count, uint8_t *hashes)
+{
+    using Word = typename Traits::Word;
+    constexpr size_t blockSize = Traits::blockSize;
+    constexpr size_t stateWords = Traits::stateWords;
+
+    struct Lane
+    {
+        /// Index of the message being hashed in this lane or count if the lane is idle.
+        size_t message;
+        /// Next full block of message data.
+        const uint8_t *data;
+        /// Number of full message blocks left.
+        size_t numDataBlocks;
+        /// Number of padded tail blocks left.
+        size_t numTailBlocks;
+        /// Next padded tail block.
+        const uint8_t *tailBlock;
+        /// Padded tail blocks.
+        alignas(8) uint8_t tail[2 * blockSize];
+    };
+
+    alignas(8) static const uint8_t zeroBlock[blockSize] = {};
+    Word state[stateWords * numLanes];
+    Lane lanes[numLanes];
+    const uint8_t *blocks[numLanes];
+    size_t nextMessage = 0;
+    size_t activeLanes = 0;
+
+    // Assign the next message to a lane (or mark the lane as idle).
+    auto startMessage = [&](size_t lane)
+    {
+        Lane &l = lanes[lane];
+        if (nextMessage >= count)
+        {
+            // Idle lane: Process a zero block on a zero state, so the SIMD rounds never read indeterminate values.
+            l.message = count;
+            for (size_t i = 0; i < stateWords; i++)
+            {
+                state[i * numLanes + lane] = 0;
+            }
+            return;
+        }
+        l.message = nextMessage++;
+        size_t length = lengths[l.message];
+        l.data = messages[l.message];
+        l.numDataBlocks = length / blockSize;
+        std::copy(l.data + l.numDataBlocks * blockSize, l.data + length, l.tail);
+        l.numTailBlocks = Traits::padMessage(l.tail, length);
+        l.tailBlock = l.tail;
+        for (size_t i = 0; i < stateWords; i++)
+        {
+            state[i * numLanes + lane] = Traits::initialState[i];
+        }
+        activeLanes++;
+    };
+
+    for (size_t lane = 0; lane < numLanes; lane++)
+    {
+        startMessage(lane);
+    }
+
+    while (activeLanes > 0)
+    {
+        for (size_t lane = 0; lane < numLanes; lane++)
+        {
+            const Lane &l = lanes[lane];
+            blocks[lane] = (l.message == count) ? zeroBlock : (l.numDataBlocks > 0) ? l.data : l.tailBlock;
+        }
+
+        processBlocks(state, blocks);
+
+        for (size_t lane = 0; lane < numLanes; lane++)
+        {
+            Lane &l = lanes[lane];
+            if (l.message == count)
+            {
+                continue;
+            }
+            if (l.numDataBlocks > 0)
+            {
+                l.data += blockSize;
+                l.numDataBlocks--;
+                continue;
+            }
+            l.tailBlock += blockSize;
+            if (--l.numTailBlocks > 0)
+            {
+                continue;
+            }
+
+            // Message done: Retire lane and refill it with the next message.
+            Word laneState[stateWords];
+            for (size_t i = 0; i < stateWords; i++)
+            {
+                laneState[i] = state[i * numLanes + lane];
+            }
+            Traits::storeHash(laneState, hashes + l.message * Traits::hashSize);
+            activeLanes--;
+            startMessage(lane);
+        }
+    }
+}
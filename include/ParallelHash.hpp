@@ -0,0 +1,295 @@
+// ParallelHash implementation.
+//
+// Copyright (c) 2026 Johannes Overmann
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <span>
+#include <vector>
+#include "KeccakMultiBuffer.hpp"
+#include "KeccakSponge.hpp"
+#include "CShake.hpp"
+#include "WorkerPool.hpp"
+
+/// ParallelHash128, ParallelHash256 and ParallelHashXOF128, ParallelHashXOF256 according to NIST SP 800-185 section 6.
+/// https://nvlpubs.nist.gov/nistpubs/SpecialPublications/NIST.SP.800-185.pdf
+/// Please use class ParallelHash128 or ParallelHash256 (see bottom of file).
+///
+/// The input is split into leaves of leafSize bytes. The leaves are hashed independently (SHAKE with 2 * securityBits
+/// output bits) and the leaf outputs are absorbed by cSHAKE with N = "ParallelHash". update() collects whole batches of
+/// leaves (large inputs are not copied) and distributes them to a worker pool. On CPUs with AVX2/AVX-512 each worker
+/// hashes 4/8 leaves in parallel in the lanes of the SIMD registers.
+///
+/// The worker pool is shared: Pass a pool to the constructor or use the process wide WorkerPool::getShared(), which is
+/// only requested when a message reaches a full batch. The batch buffer is at most maxBatchSize bytes. Leaves larger
+/// than that are not buffered: Partial leaves are absorbed on the calling thread, only whole leaves passed to one
+/// update() call are hashed in parallel.
+///
+/// The result depends on leafSize. Use the same leafSize for hashing and verification.
+template<size_t securityBits>
+class ParallelHash
+{
+public:
+    /// Block size (rate) in bytes.
+    static constexpr size_t blockSize = CShake<securityBits>::blockSize;
+
+    /// Size of each leaf output in bytes.
+    static constexpr size_t leafOutputSize = securityBits / 4;
+
+    /// Default leaf size in bytes.
+    static constexpr size_t defaultLeafSize = 8192;
+
+    /// Maximum size of the batch buffer in bytes.
+    static constexpr size_t maxBatchSize = 4 << 20;
+
+    /// Absorb the prefix for leafSize and customization.
+    /// Leaves are hashed on pool, or on WorkerPool::getShared() if pool is nullptr.
+    explicit ParallelHash(size_t leafSize = defaultLeafSize, std::span<const uint8_t> customization = {}, std::shared_ptr<WorkerPool> pool = nullptr):
+        leafSize(leafSize), pool(std::move(pool)), prefix("ParallelHash", customization)
+    {
+        assert(leafSize > 0);
+        prefix.updateLeftEncoded(leafSize);
+        batchSize = std::clamp<size_t>(maxBatchSize / leafSize, 1, maxBatchLeaves) * leafSize;
+        clear();
+    }
+
+    /// Start a new message.
+    void clear()
+    {
+        outer = prefix;
+        bufferedBytes = 0;
+        leafSponge.clear();
+        leafPos = 0;
+        numLeaves = 0;
+        squeezing = false;
+    }
+
+    /// Add data.
+    /// Must not be called after squeeze() (without clear()).
+    void update(const uint8_t *bytes, size_t n)
+    {
+        assert(!squeezing);
+        if (leafPos > 0)
+        {
+            // Complete the partial leaf (leaves larger than maxBatchSize).
+            size_t num = std::min(n, leafSize - leafPos);
+            leafSponge.absorb(bytes, num);
+            leafPos += num;
+            bytes += num;
+            n -= num;
+            if (leafPos < leafSize)
+            {
+                return;
+            }
+            finishLeafSponge();
+        }
+        else if (bufferedBytes > 0)
+        {
+            size_t num = std::min(n, batchSize - bufferedBytes);
+            std::copy(bytes, bytes + num, buffer.data() + bufferedBytes);
+            bufferedBytes += num;
+            bytes += num;
+            n -= num;
+            if (bufferedBytes < batchSize)
+            {
+                return;
+            }
+            hashLeaves(buffer.data(), batchSize);
+            bufferedBytes = 0;
+        }
+
+        // Hash whole leaves directly from the input.
+        while (n >= batchSize)
+        {
+            size_t num = std::min<size_t>(n / leafSize, maxBatchLeaves) * leafSize;
+            hashLeaves(bytes, num);
+            bytes += num;
+            n -= num;
+        }
+
+        if (n == 0)
+        {
+            return;
+        }
+        if (batchSize > maxBatchSize)
+        {
+            leafSponge.absorb(bytes, n);
+            leafPos = n;
+        }
+        else
+        {
+            buffer.resize(batchSize);
+            std::copy(bytes, bytes + n, buffer.data());
+            bufferedBytes = n;
+        }
+    }
+
+    /// Fixed length mode (ParallelHash): Write the hash of length hash.size() to hash and start a new message.
+    void finalize(std::span<uint8_t> hash)
+    {
+        finishInput(uint64_t(hash.size()) * 8);
+        outer.squeeze(hash);
+        clear();
+    }
+
+    /// XOF mode (ParallelHashXOF): Write the next output.size() output bytes to output.
+    /// The first call finishes the input. Subsequent calls continue the output stream. Call clear() to start a new message.
+    void squeeze(std::span<uint8_t> output)
+    {
+        if (!squeezing)
+        {
+            finishInput(0);
+            squeezing = true;
+        }
+        outer.squeeze(output);
+    }
+
+    /// Write the leaf outputs of count leaves (leaves[i] with lengths[i] bytes) to outputs + i * leafOutputSize.
+    /// On CPUs with AVX2/AVX-512 4/8 leaves are hashed in parallel in the lanes of the SIMD registers.
+    static void calcLeaves(const uint8_t *const *leaves, const size_t *lengths, size_t count, uint8_t *outputs)
+    {
+        if (KeccakMultiBuffer<blockSize, 0x1f, leafOutputSize>::calcHashes(leaves, lengths, count, outputs))
+        {
+            return;
+        }
+        for (size_t i = 0; i < count; i++)
+        {
+            KeccakSponge<blockSize> sponge;
+            sponge.absorb(leaves[i], lengths[i]);
+            sponge.pad(0x1f);
+            sponge.squeeze(outputs + i * leafOutputSize, leafOutputSize);
+        }
+    }
+
+private:
+    /// Leaves per worker task (one multi-buffer run).
+    static constexpr size_t leavesPerTask = 8;
+
+    /// Maximum number of leaves per batch (limits the leaf outputs of a batch for small leaves).
+    static constexpr size_t maxBatchLeaves = 4096;
+
+    /// Hash the leaves of n bytes of data (the last leaf may be shorter than leafSize) and absorb the leaf outputs.
+    void hashLeaves(const uint8_t *data, size_t n)
+    {
+        size_t count = (n + leafSize - 1) / leafSize;
+        leafOutputs.resize(count * leafOutputSize);
+        auto task = [&](size_t taskIndex)
+        {
+            const uint8_t *leaves[leavesPerTask];
+            size_t lengths[leavesPerTask];
+            size_t first = taskIndex * leavesPerTask;
+            size_t num = std::min(leavesPerTask, count - first);
+            for (size_t i = 0; i < num; i++)
+            {
+                size_t offset = (first + i) * leafSize;
+                leaves[i] = data + offset;
+                lengths[i] = std::min(leafSize, n - offset);
+            }
+            calcLeaves(leaves, lengths, num, leafOutputs.data() + first * leafOutputSize);
+        };
+        size_t numTasks = (count + leavesPerTask - 1) / leavesPerTask;
+
+        // Short messages never start the threads of the shared pool.
+        if (!pool && (n >= batchSize))
+        {
+            pool = WorkerPool::getShared();
+        }
+        if (pool)
+        {
+            pool->run(numTasks, task);
+        }
+        else
+        {
+            for (size_t i = 0; i < numTasks; i++)
+            {
+                task(i);
+            }
+        }
+        outer.update(leafOutputs.data(), count * leafOutputSize);
+        numLeaves += count;
+    }
+
+    /// Absorb the output of the leaf in leafSponge.
+    void finishLeafSponge()
+    {
+        uint8_t output[leafOutputSize];
+        leafSponge.pad(0x1f);
+        leafSponge.squeeze(output, leafOutputSize);
+        outer.update(output, leafOutputSize);
+        numLeaves++;
+        leafSponge.clear();
+        leafPos = 0;
+    }
+
+    /// Hash the buffered leaves and add right_encode(n) || right_encode(outputBits).
+    void finishInput(uint64_t outputBits)
+    {
+        if (bufferedBytes > 0)
+        {
+            hashLeaves(buffer.data(), bufferedBytes);
+            bufferedBytes = 0;
+        }
+        if (leafPos > 0)
+        {
+            finishLeafSponge();
+        }
+        outer.updateRightEncoded(numLeaves);
+        outer.updateRightEncoded(outputBits);
+    }
+
+    /// Leaf size B in bytes.
+    size_t leafSize;
+
+    /// Bytes per buffered batch of leaves (whole leaves, at most maxBatchSize unless leafSize is larger).
+    size_t batchSize;
+
+    /// Worker threads (nullptr until the first full batch if no pool was passed to the constructor).
+    std::shared_ptr<WorkerPool> pool;
+
+    /// cSHAKE state after bytepad(encode_string("ParallelHash") || encode_string(S)) || left_encode(leafSize).
+    CShake<securityBits> prefix;
+
+    /// cSHAKE state absorbing the leaf outputs.
+    CShake<securityBits> outer;
+
+    /// Partial batch of leaves.
+    std::vector<uint8_t> buffer;
+
+    /// Number of bytes in buffer.
+    size_t bufferedBytes;
+
+    /// Partial leaf (leaves larger than maxBatchSize).
+    KeccakSponge<blockSize> leafSponge;
+
+    /// Number of bytes absorbed into leafSponge.
+    size_t leafPos;
+
+    /// Leaf outputs of the current batch.
+    std::vector<uint8_t> leafOutputs;
+
+    /// Number of leaves absorbed so far.
+    uint64_t numLeaves;
+
+    /// Input finished in XOF mode.
+    bool squeezing;
+};
+
+/// ParallelHash variants.
+class ParallelHash128: public ParallelHash<128>
+{
+public:
+    using ParallelHash<128>::ParallelHash;
+};
+
+class ParallelHash256: public ParallelHash<256>
+{
+public:
+    using ParallelHash<256>::ParallelHash;
+};
@@ -0,0 +1,134 @@
+// PBKDF2 implementation.
+//
+// Copyright (c) 2026 Johannes Overmann
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <cassert>
+#include <span>
+#include <vector>
+#include "Hmac.hpp"
+#include "WorkerPool.hpp"
+
+/// PBKDF2 with HMAC according to RFC 8018 section 5.2 for all hash classes.
+/// https://www.rfc-editor.org/rfc/rfc8018#section-5.2
+///
+/// The HMAC key states are computed once. For MD5, SHA-1, SHA-256 and SHA-512 each iteration is exactly two
+/// compressions of single blocks whose padding is built once, so only the first hashSize bytes of the blocks change.
+/// Several output blocks are derived in parallel on the shared worker pool (WorkerPool::getShared(), one thread per
+/// hardware thread), so concurrent calls do not start threads of their own.
+template<class HashClass>
+class Pbkdf2
+{
+public:
+    /// Output block size in bytes.
+    static constexpr size_t hashSize = HashClass::hashSize;
+
+    /// Minimum number of iterations to derive output blocks in parallel on the worker pool.
+    static constexpr unsigned minParallelIterations = 1024;
+
+    /// Maximum key length in bytes ((2^32 - 1) * hashSize, RFC 8018 section 5.2 step 1).
+    static constexpr uint64_t maxKeyLength = uint64_t(0xffffffff) * hashSize;
+
+    /// Derive keyLength bytes (at most maxKeyLength) from password and salt with iterations iterations (at least 1).
+    static void deriveKey(const uint8_t *password, size_t passwordLength, const uint8_t *salt, size_t saltLength, unsigned iterations, uint8_t *key, size_t keyLength)
+    {
+        assert(iterations >= 1);
+        assert(keyLength <= maxKeyLength);
+        Hmac<HashClass> hmac(password, passwordLength);
+        size_t numBlocks = (keyLength + hashSize - 1) / hashSize;
+
+        // Task i derives output block T_{i + 1}.
+        auto task = [&](size_t i)
+        {
+            uint8_t t[hashSize];
+            deriveBlock(hmac, salt, saltLength, iterations, uint32_t(i + 1), t);
+            std::copy(t, t + std::min(hashSize, keyLength - i * hashSize), key + i * hashSize);
+        };
+        if ((numBlocks > 1) && (iterations >= minParallelIterations))
+        {
+            WorkerPool::getShared()->run(numBlocks, task);
+        }
+        else
+        {
+            for (size_t i = 0; i < numBlocks; i++)
+            {
+                task(i);
+            }
+        }
+    }
+
+    /// Derive keyLength bytes (at most maxKeyLength) from password and salt with iterations iterations (at least 1).
+    static std::vector<uint8_t> deriveKey(std::span<const uint8_t> password, std::span<const uint8_t> salt, unsigned iterations, size_t keyLength)
+    {
+        std::vector<uint8_t> r(keyLength);
+        deriveKey(password.data(), password.size(), salt.data(), salt.size(), iterations, r.data(), keyLength);
+        return r;
+    }
+
+private:
+    /// Derive output block T_blockIndex (hashSize bytes) into t.
+    static void deriveBlock(const Hmac<HashClass> &hmac, const uint8_t *salt, size_t saltLength, unsigned iterations, uint32_t blockIndex, uint8_t *t)
+    {
+        // U_1 = HMAC(P, S || INT(blockIndex)).
+        const uint8_t index[4] = { uint8_t(blockIndex >> 24), uint8_t(blockIndex >> 16), uint8_t(blockIndex >> 8), uint8_t(blockIndex) };
+        Hmac<HashClass> first = hmac;
+        first.update(salt, saltLength);
+        first.update(index, 4);
+        uint8_t u[hashSize];
+        first.finalize(u);
+        std::copy(u, u + hashSize, t);
+
+        if constexpr (requires(uint8_t *block) { HashClass::padMessage(block, size_t(0)); HashClass::compressBlocks(nullptr, block, 1); })
+        {
+            // U_j = HMAC(P, U_{j-1}): Continue from the key states with the padded single blocks U_{j-1} and H(K ^ ipad || U_{j-1}).
+            using Word = typename HashClass::Word;
+            constexpr size_t stateWords = HashClass::stateWords;
+            constexpr size_t blockSize = HashClass::blockSize;
+            Word innerState[stateWords];
+            Word outerState[stateWords];
+            hmac.getInnerHasher().getChainingState(innerState);
+            hmac.getOuterHasher().getChainingState(outerState);
+            alignas(8) uint8_t innerBlock[blockSize * 2];
+            alignas(8) uint8_t outerBlock[blockSize * 2];
+            std::copy(u, u + hashSize, innerBlock);
+
+            // U and the length field fit into a single block, so the loop below compresses exactly one block per hasher.
+            [[maybe_unused]] size_t numInnerBlocks = HashClass::padMessage(innerBlock, blockSize + hashSize);
+            [[maybe_unused]] size_t numOuterBlocks = HashClass::padMessage(outerBlock, blockSize + hashSize);
+            assert((numInnerBlocks == 1) && (numOuterBlocks == 1));
+            for (unsigned j = 1; j < iterations; j++)
+            {
+                Word s[stateWords];
+                std::copy(innerState, innerState + stateWords, s);
+                HashClass::compressBlocks(s, innerBlock, 1);
+                HashClass::storeHash(s, outerBlock);
+                std::copy(outerState, outerState + stateWords, s);
+                HashClass::compressBlocks(s, outerBlock, 1);
+                HashClass::storeHash(s, innerBlock);
+                for (size_t i = 0; i < hashSize; i++)
+                {
+                    t[i] ^= innerBlock[i];
+                }
+            }
+        }
+        else
+        {
+            for (unsigned j = 1; j < iterations; j++)
+            {
+                uint8_t next[hashSize];
+                hmac.calcMac(u, hashSize, next);
+                std::copy(next, next + hashSize, u);
+                for (size_t i = 0; i < hashSize; i++)
+                {
+                    t[i] ^= u[i];
+                }
+            }
+        }
+    }
+};
@@ -0,0 +1,70 @@
+// SHAKE extendable-output functions.
+//
+// Copyright (c) 2026 Johannes Overmann
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <stdint.h>
+#include <span>
+#include <vector>
+#include "KeccakSponge.hpp"
+
+/// SHAKE128 and SHAKE256 extendable-output functions (XOF) according to FIPS PUB 202 section 6.2.
+/// https://nvlpubs.nist.gov/nistpubs/FIPS/NIST.FIPS.202.pdf
+/// Please use class Shake128 or Shake256 (see bottom of file).
+///
+/// Usage: Call update() any number of times, then squeeze() any number of times to get a continuous output stream.
+template<size_t securityBits>
+class Shake
+{
+public:
+    /// Block size (rate) in bytes.
+    static constexpr size_t blockSize = 200 - securityBits / 4;
+
+    /// Initialize XOF.
+    /// Call this after squeezing and before absorbing new data.
+    void clear()
+    {
+        sponge.clear();
+    }
+
+    /// Add data.
+    /// Must not be called after squeeze() (without clear()).
+    void update(const uint8_t *bytes, size_t n)
+    {
+        sponge.absorb(bytes, n);
+    }
+
+    /// Write the next output.size() output bytes to output.
+    /// The first call finishes the input. Subsequent calls continue the output stream, so squeezing n and then m bytes
+    /// gives the same bytes as squeezing n + m bytes at once.
+    void squeeze(std::span<uint8_t> output)
+    {
+        if (!sponge.isSqueezing())
+        {
+            sponge.pad(0x1f);
+        }
+        sponge.squeeze(output.data(), output.size());
+    }
+
+    /// Get outputLength output bytes of n bytes.
+    static std::vector<uint8_t> calcXof(const uint8_t *bytes, size_t n, size_t outputLength)
+    {
+        Shake xof;
+        xof.update(bytes, n);
+        std::vector<uint8_t> r(outputLength);
+        xof.squeeze(r);
+        return r;
+    }
+
+private:
+    /// Sponge with capacity 2 * securityBits.
+    KeccakSponge<blockSize> sponge;
+};
+
+/// SHAKE variants.
+class Shake128: public Shake<128> {};
+class Shake256: public Shake<256> {};
@@ -0,0 +1,155 @@
+// Worker thread pool.
+//
+// Copyright (c) 2026 Johannes Overmann
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// Fixed set of worker threads which run batches of independent tasks.
+/// The threads are started once in the constructor and sleep between batches, so small batches do not pay for thread creation.
+/// Share one pool between all users (see getShared()) instead of creating one per object.
+class WorkerPool
+{
+public:
+    /// Start numThreads - 1 worker threads (the thread calling run() is the remaining thread).
+    /// numThreads == 0 uses one thread per hardware thread.
+    explicit WorkerPool(unsigned numThreads = 0)
+    {
+        if (numThreads == 0)
+        {
+            numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+        }
+        for (unsigned i = 1; i < numThreads; i++)
+        {
+            threads.emplace_back([this]() { work(); });
+        }
+    }
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    /// Stop and join all worker threads.
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeWorkers.notify_all();
+        for (std::thread &thread: threads)
+        {
+            thread.join();
+        }
+    }
+
+    /// Get the process wide pool with one thread per hardware thread.
+    /// The threads are started on the first call.
+    static std::shared_ptr<WorkerPool> getShared()
+    {
+        static const std::shared_ptr<WorkerPool> shared = std::make_shared<WorkerPool>();
+        return shared;
+    }
+
+    /// Get number of threads including the calling thread.
+    unsigned getNumThreads() const
+    {
+        return unsigned(threads.size()) + 1;
+    }
+
+    /// Call task(i) for i = 0 .. numTasks - 1 on the worker threads and on the calling thread.
+    /// Returns when all tasks are done. Tasks are taken in order, so tasks of similar size balance well.
+    /// Several threads may call run() concurrently: While the workers are busy with the batch of another caller the tasks
+    /// run on the calling thread.
+    void run(size_t numTasks, const std::function<void(size_t)> &task)
+    {
+        std::unique_lock<std::mutex> batchLock(batchMutex, std::try_to_lock);
+        if (threads.empty() || (numTasks <= 1) || !batchLock.owns_lock())
+        {
+            for (size_t i = 0; i < numTasks; i++)
+            {
+                task(i);
+            }
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            currentTask = &task;
+            currentNumTasks = numTasks;
+            nextTask = 0;
+            numBusyWorkers = threads.size();
+            generation++;
+        }
+        wakeWorkers.notify_all();
+        runTasks(task, numTasks);
+
+        // Wait until all workers left this batch, so none of them takes a task index of the next batch.
+        std::unique_lock<std::mutex> lock(mutex);
+        workersDone.wait(lock, [this]() { return numBusyWorkers == 0; });
+        currentTask = nullptr;
+    }
+
+private:
+    /// Worker thread: Run the tasks of each batch.
+    void work()
+    {
+        uint64_t seenGeneration = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true)
+        {
+            wakeWorkers.wait(lock, [&]() { return stopping || (generation != seenGeneration); });
+            if (stopping)
+            {
+                return;
+            }
+            seenGeneration = generation;
+            const std::function<void(size_t)> &task = *currentTask;
+            size_t numTasks = currentNumTasks;
+            lock.unlock();
+            runTasks(task, numTasks);
+            lock.lock();
+            if (--numBusyWorkers == 0)
+            {
+                workersDone.notify_one();
+            }
+        }
+    }
+
+    /// Take and run tasks until there are none left.
+    void runTasks(const std::function<void(size_t)> &task, size_t numTasks)
+    {
+        for (size_t i = nextTask++; i < numTasks; i = nextTask++)
+        {
+            task(i);
+        }
+    }
+
+    std::vector<std::thread> threads;
+
+    /// Held by the caller whose batch the workers run.
+    std::mutex batchMutex;
+
+    std::mutex mutex;
+    std::condition_variable wakeWorkers;
+    std::condition_variable workersDone;
+
+    /// Current batch (protected by mutex, except nextTask).
+    const std::function<void(size_t)> *currentTask = nullptr;
+    size_t currentNumTasks = 0;
+    std::atomic<size_t> nextTask = 0;
+    size_t numBusyWorkers = 0;
+    uint64_t generation = 0;
+    bool stopping = false;
+};
@@ -6,6 +6,7 @@
 // (See accompanying file LICENSE or copy at https://www.boost.org/LICENSE_1_0.txt)
 
 #include "HashSha3.hpp"
+#include "KeccakP1600.hpp"
 #include "refSha3_224.hpp"
 #include "refSha3_256.hpp"
 #include "refSha3_384.hpp"
@@ -19,9 +20,18 @@
 #include "HashMd5.hpp"
 #include "refMd5.hpp"
 #include "Hash.hpp"
+#include "Hmac.hpp"
+#include "Pbkdf2.hpp"
+#include "Shake.hpp"
+#include "CShake.hpp"
+#include "Kmac.hpp"
+#include "ParallelHash.hpp"
+#include "Digest.hpp"
+#include "Hex.hpp"
 
 #include "MiscUtils.hpp"
 #include "CommandLineParser.hpp"
+#include "UnitTest.hpp"
 #include <exception>
 #include <iomanip>
 
@@ -63,6 +73,19 @@ unsigned testHash(const std::string& input, const std::string& hexReferenceHash)
     // Test adding whole input at once.
     errors += checkHash("all", hexReferenceHash, ut1::hexlify(calcHash<HashClass>(input)), ut1::typeName<HashClass>(), input);
 
+    // Test allocation free interface.
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(input.data());
+    std::array<uint8_t, HashClass::hashSize> hashArray = calcHashArray<HashClass>(bytes, input.length());
+    errors += checkHash("array", hexReferenceHash, ut1::hexlify(std::vector<uint8_t>(hashArray.begin(), hashArray.end())), ut1::typeName<HashClass>(), input);
+    std::vector<uint8_t> hashSpan(HashClass::hashSize);
+    calcHash<HashClass>(bytes, input.length(), hashSpan);
+    errors += checkHash("span", hexReferenceHash, ut1::hexlify(hashSpan), ut1::typeName<HashClass>(), input);
+
+    // Test streaming interface (calcHash() uses the one-shot path).
+    HashClass streamHasher;
+    updateHash(streamHasher, input);
+    errors += checkHash("update", hexReferenceHash, ut1::hexlify(streamHasher.finalize()), ut1::typeName<HashClass>(), input);
+
 #if 1
     // Test adding individual bytes of data.
     HashClass hasher;
@@ -98,6 +121,609 @@ unsigned testRefList(const char *hashes[])
     return errors;
 }
 
+/// Test multi-buffer hashing of all reference inputs at once.
+template<class HashClass>
+unsigned testRefListMulti(const char *hashes[])
+{
+    std::vector<std::vector<uint8_t>> messages;
+    for (size_t i = 0; hashes[i]; i++)
+    {
+        messages.emplace_back(i, 'a');
+    }
+    std::vector<std::vector<uint8_t>> actual = calcHashes<HashClass>(messages);
+    unsigned errors = 0;
+    for (size_t i = 0; hashes[i]; i++)
+    {
+        errors += checkHash("multi", hashes[i], ut1::hexlify(actual[i]), ut1::typeName<HashClass>(), std::string(i, 'a'));
+    }
+
+    // Fewer messages than SIMD lanes (idle lanes from the start).
+    for (size_t count: {1, 3, 7})
+    {
+        std::vector<std::vector<uint8_t>> few(messages.end() - count, messages.end());
+        actual = calcHashes<HashClass>(few);
+        for (size_t i = 0; i < count; i++)
+        {
+            size_t length = messages.size() - count + i;
+            errors += checkHash("multi-few", hashes[length], ut1::hexlify(actual[i]), ut1::typeName<HashClass>(), std::string(length, 'a'));
+        }
+    }
+    std::cout << std::left << std::setw(hashNameLen) << ut1::typeName<HashClass>() << ": multi-buffer " << (errors ? "failed" : "ok") << "\n";
+    return errors;
+}
+
+/// Straightforward Keccak-p[1600, numRounds] according to FIPS PUB 202 to check KeccakP1600 against.
+static void keccakP1600Reference(uint64_t *a, unsigned numRounds)
+{
+    static const unsigned rho[25] = { 0, 1, 62, 28, 27, 36, 44, 6, 55, 20, 3, 10, 43, 25, 39, 41, 45, 15, 21, 8, 18, 2, 61, 56, 14 };
+    uint64_t rc[24];
+    uint8_t lfsr = 1;
+    for (unsigned round = 0; round < 24; round++)
+    {
+        rc[round] = 0;
+        for (unsigned j = 0; j < 7; j++)
+        {
+            if (lfsr & 1)
+            {
+                rc[round] |= uint64_t(1) << ((1u << j) - 1);
+            }
+            lfsr = (lfsr << 1) ^ ((lfsr & 0x80) ? 0x71 : 0);
+        }
+    }
+    for (unsigned round = 24 - numRounds; round < 24; round++)
+    {
+        uint64_t c[5], b[25];
+        for (unsigned x = 0; x < 5; x++)
+        {
+            c[x] = a[x] ^ a[x + 5] ^ a[x + 10] ^ a[x + 15] ^ a[x + 20];
+        }
+        for (unsigned x = 0; x < 5; x++)
+        {
+            for (unsigned y = 0; y < 5; y++)
+            {
+                uint64_t lane = a[x + 5 * y] ^ c[(x + 4) % 5] ^ std::rotl(c[(x + 1) % 5], 1);
+                b[y + 5 * ((2 * x + 3 * y) % 5)] = std::rotl(lane, rho[x + 5 * y]);
+            }
+        }
+        for (unsigned x = 0; x < 5; x++)
+        {
+            for (unsigned y = 0; y < 5; y++)
+            {
+                a[x + 5 * y] = b[x + 5 * y] ^ (~b[(x + 1) % 5 + 5 * y] & b[(x + 2) % 5 + 5 * y]);
+            }
+        }
+        a[0] ^= rc[round];
+    }
+}
+
+/// Check KeccakP1600<numRounds> (dispatched and portable implementation) against keccakP1600Reference().
+template<unsigned numRounds>
+static void testKeccakP1600Rounds()
+{
+    using ut1::toStr;
+    uint64_t expected[25];
+    for (unsigned i = 0; i < 25; i++)
+    {
+        expected[i] = 0x9e3779b97f4a7c15 * (i + 1);
+    }
+    uint64_t actual[25], actualPortable[25];
+    std::copy(expected, expected + 25, actual);
+    std::copy(expected, expected + 25, actualPortable);
+    keccakP1600Reference(expected, numRounds);
+
+    KeccakP1600<numRounds>::permute(actual);
+    KeccakP1600<numRounds>::permutePortable(actualPortable);
+    for (unsigned i = 0; i < 25; i++)
+    {
+        ASSERT_EQ(actual[i], expected[i]);
+        ASSERT_EQ(actualPortable[i], expected[i]);
+    }
+}
+
+UNIT_TEST(KeccakP1600)
+{
+    using ut1::toStr;
+
+    // Keccak-f[1600] of the all-zero state (Keccak team intermediate values).
+    uint64_t state[25] = {};
+    KeccakP1600<24>::permute(state);
+    ASSERT_EQ(state[0], uint64_t(0xf1258f7940e1dde7));
+    ASSERT_EQ(state[1], uint64_t(0x84d5ccf933c0478a));
+    ASSERT_EQ(state[12], uint64_t(0x81a57c16dbcf555f));
+    ASSERT_EQ(state[24], uint64_t(0xeaf1ff7b5ceca249));
+
+    // TurboSHAKE128 of the empty message (D = 0x1f, RFC 9861) uses 12 rounds.
+    uint8_t sponge[200] = {};
+    sponge[0] = 0x1f;
+    sponge[167] = 0x80;
+    uint64_t words[25];
+    memcpy(words, sponge, sizeof(words));
+    KeccakP1600<12>::permute(words);
+    memcpy(sponge, words, sizeof(words));
+    ASSERT_EQ(ut1::hexlify(std::vector<uint8_t>(sponge, sponge + 32)), "1e415f1c5983aff2169217277d17bb538cd945a397ddec541f1ce41af2c1b74c");
+
+    testKeccakP1600Rounds<1>();
+    testKeccakP1600Rounds<2>();
+    testKeccakP1600Rounds<12>();
+    testKeccakP1600Rounds<13>();
+    testKeccakP1600Rounds<23>();
+    testKeccakP1600Rounds<24>();
+}
+
+UNIT_TEST(CpuFeaturesRestrictTo)
+{
+    using ut1::toStr;
+    CpuFeatures all;
+    all.ssse3 = all.sse41 = all.sha = all.avx = all.avx2 = all.bmi2 = all.avx512f = true;
+
+    CpuFeatures scalar = CpuFeatures::restrictTo(all, "scalar");
+    ASSERT_EQ(scalar.ssse3 || scalar.sse41 || scalar.sha || scalar.avx || scalar.avx2 || scalar.bmi2 || scalar.avx512f, false);
+
+    CpuFeatures avx2 = CpuFeatures::restrictTo(all, "avx2");
+    ASSERT_EQ(avx2.avx2 && avx2.bmi2 && avx2.avx && avx2.ssse3, true);
+    ASSERT_EQ(avx2.avx512f || avx2.sha, false);
+
+    CpuFeatures shani = CpuFeatures::restrictTo(all, "shani");
+    ASSERT_EQ(shani.sha && shani.sse41, true);
+    ASSERT_EQ(shani.avx || shani.avx2 || shani.avx512f, false);
+
+    // Restricting never enables features and unknown values are ignored.
+    ASSERT_EQ(CpuFeatures::restrictTo(CpuFeatures(), "avx512").avx512f, false);
+    ASSERT_EQ(CpuFeatures::restrictTo(all, "unknown").avx512f, true);
+    ASSERT_EQ(CpuFeatures::restrictTo(all, nullptr).sha, true);
+}
+
+UNIT_TEST(Hex)
+{
+    using ut1::toStr;
+    std::vector<uint8_t> bytes(100);
+    for (size_t i = 0; i < bytes.size(); i++)
+    {
+        bytes[i] = uint8_t(i * 73 + 5);
+    }
+    for (size_t n = 0; n <= bytes.size(); n++)
+    {
+        std::string expected = ut1::hexlify(std::vector<uint8_t>(bytes.begin(), bytes.begin() + n));
+        std::string hex(n * 2, '\0');
+        Hex::encodePortable(bytes.data(), n, hex.data());
+        ASSERT_EQ(hex, expected);
+        ASSERT_EQ(Hex::encode(std::span<const uint8_t>(bytes.data(), n)), expected);
+
+        std::vector<uint8_t> decoded(n);
+        ASSERT_EQ(Hex::decode(expected.data(), n, decoded.data()), true);
+        ASSERT_EQ(ut1::hexlify(decoded), expected);
+        std::vector<uint8_t> decodedPortable(n);
+        ASSERT_EQ(Hex::decodePortable(ut1::toupper(expected).data(), n, decodedPortable.data()), true);
+        ASSERT_EQ(ut1::hexlify(decodedPortable), expected);
+
+        // Every invalid character at any position is detected.
+        for (char invalid: {'g', 'G', '/', ':', '@', '`', ' ', '\x80', '\xff'})
+        {
+            for (size_t i = 0; i < n * 2; i += 7)
+            {
+                std::string bad = expected;
+                bad[i] = invalid;
+                ASSERT_EQ(Hex::decode(bad.data(), n, decoded.data()), false);
+                ASSERT_EQ(Hex::decodePortable(bad.data(), n, decoded.data()), false);
+            }
+        }
+    }
+}
+
+UNIT_TEST(Digest)
+{
+    using ut1::toStr;
+    static_assert(std::is_trivially_copyable_v<Digest<32>>);
+
+    const std::string hex = "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad";
+    Digest<32> digest = calcDigest<HashSha256>(std::span<const uint8_t>(reinterpret_cast<const uint8_t *>("abc"), 3));
+    ASSERT_EQ(digest.toHex(), hex);
+    ASSERT_EQ(Digest<32>::fromHex(hex) == digest, true);
+    ASSERT_EQ(Digest<32>::fromHex(ut1::toupper(hex)) == digest, true);
+    ASSERT_EQ(Digest<32>::fromHex(hex.substr(2)).has_value(), false);
+    ASSERT_EQ(Digest<32>::fromHex("x" + hex.substr(1)).has_value(), false);
+    ASSERT_EQ(std::hash<Digest<32>>()(digest), size_t(0xeacf018fbf1678ba));
+
+    Digest<32> other = digest;
+    ASSERT_EQ(other == digest, true);
+    other.bytes[31]++;
+    ASSERT_EQ(other != digest, true);
+    ASSERT_EQ(digest < other, true);
+}
+
+/// Check HMAC (one-shot, streaming and verification) against a reference value.
+template<class HashClass>
+void testHmac(const std::string &key, const std::string &message, const std::string &expected)
+{
+    using ut1::toStr;
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(message.data());
+    Hmac<HashClass> hmac(reinterpret_cast<const uint8_t *>(key.data()), key.size());
+    std::array<uint8_t, Hmac<HashClass>::macSize> mac = hmac.calcMac(bytes, message.size());
+    ASSERT_EQ(ut1::hexlify(std::vector<uint8_t>(mac.begin(), mac.end())), expected);
+
+    // Streaming interface, twice to check that finalize() restarts from the key state.
+    for (unsigned pass = 0; pass < 2; pass++)
+    {
+        for (size_t i = 0; i < message.size(); i++)
+        {
+            hmac.update(bytes + i, 1);
+        }
+        ASSERT_EQ(hmac.finalizeArray() == mac, true);
+    }
+
+    ASSERT_EQ(hmac.verify(bytes, message.size(), mac), true);
+    ASSERT_EQ(hmac.verify(bytes, message.size(), std::span<const uint8_t>(mac.data(), mac.size() - 1)), false);
+    mac[mac.size() - 1] ^= 1;
+    ASSERT_EQ(hmac.verify(bytes, message.size(), mac), false);
+}
+
+UNIT_TEST(Hmac)
+{
+    // RFC 2202 and RFC 4231 test cases 1 and 6 (key longer than the block size).
+    const std::string key1(20, '\x0b');
+    const std::string key6(131, '\xaa');
+    const std::string message6 = "Test Using Larger Than Block-Size Key - Hash Key First";
+    testHmac<HashMd5>(key1.substr(0, 16), "Hi There", "9294727a3638bb1c13f48ef8158bfc9d");
+    testHmac<HashSha1>(key1, "Hi There", "b617318655057264e28bc0b6fb378c8ef146be00");
+    testHmac<HashSha256>(key1, "Hi There", "b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7");
+    testHmac<HashSha256>(key6, message6, "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54");
+    testHmac<HashSha512>(key1, "Hi There", "87aa7cdea5ef619d4ff0b4241a1d6cb02379f4e2ce4ec2787ad0b30545e17cdedaa833b7d6b8a702038b274eaea3f4e4be9d914eeb61f1702e696c203a126854");
+    testHmac<HashSha3_256>(key1, "Hi There", "ba85192310dffa96e2a3a40e69774351140bb7185e1202cdcc917589f95e16bb");
+    testHmac<HashSha3_512>(key6, message6, "00f751a9e50695b090ed6911a4b65524951cdc15a73a5d58bb55215ea2cd839ac79d2b44a39bafab27e83fde9e11f6340b11d991b1b91bf2eee7fc872426c3a4");
+}
+
+/// Check PBKDF2 against a reference value.
+template<class HashClass>
+void testPbkdf2(const std::string &password, const std::string &salt, unsigned iterations, const std::string &expected)
+{
+    using ut1::toStr;
+    std::vector<uint8_t> key = Pbkdf2<HashClass>::deriveKey(std::span<const uint8_t>(reinterpret_cast<const uint8_t *>(password.data()), password.size()),
+                                                             std::span<const uint8_t>(reinterpret_cast<const uint8_t *>(salt.data()), salt.size()), iterations, expected.size() / 2);
+    ASSERT_EQ(ut1::hexlify(key), expected);
+}
+
+UNIT_TEST(Pbkdf2)
+{
+    // RFC 6070 test vectors and values from Python's hashlib.pbkdf2_hmac().
+    const std::string password = "passwordPASSWORDpassword";
+    const std::string salt = "saltSALTsaltSALTsaltSALTsaltSALTsalt";
+    testPbkdf2<HashSha1>("password", "salt", 1, "0c60c80f961f0e71f3a9b524af6012062fe037a6");
+    testPbkdf2<HashSha1>("password", "salt", 4096, "4b007901b765489abead49d926f721d065a429c1");
+    testPbkdf2<HashSha1>(password, salt, 4096, "3d2eec4fe41c849b80c8d83662c0e44a8b291a964cf2f07038");
+    testPbkdf2<HashSha256>("password", "salt", 4096, "c5e478d59288c841aa530db6845c4c8d962893a001ce4e11a4963873aa98134a");
+    testPbkdf2<HashSha256>(password, salt, 4096, "348c89dbcbd32b2f32d814b8116e84cf2b17347ebc1800181c4e2a1fb8dd53e1c635518c7dac47e9");
+    testPbkdf2<HashSha512>("password", "salt", 2000, "63bc909c307df9d7e63d58529e684455ee354a3dc78d930811e469297af1b9466da652600dcc0563f98cf74843bd67409b4594e87702e61b18c2bb3e757601737779c0ac601715e1a2143fe0ad7e608bfffbf64705e3b0737a05b5dc7e383bde59aa040c");
+    testPbkdf2<HashMd5>("password", "salt", 3, "f6acd4bda3e4d3d831a5f61da9ca9d5c3877566e979f4928778d81be4f2e9433a31043bbf3945c35");
+    testPbkdf2<HashSha3_256>("password", "salt", 3, "6677065466c97fdef1c15ae8d95020ca948334f53eceeafc6115ddf405f6d6a4f75ba13a75082d8d");
+}
+
+/// Check SHAKE: Bytes 468 to 499 of the output for a 1000 byte message and incremental absorbing and squeezing.
+template<class XofClass>
+void testShake(const std::string &expectedEmpty, const std::string &expectedTail)
+{
+    using ut1::toStr;
+    ASSERT_EQ(ut1::hexlify(XofClass::calcXof(nullptr, 0, expectedEmpty.size() / 2)), expectedEmpty);
+
+    std::vector<uint8_t> message(1000);
+    for (size_t i = 0; i < message.size(); i++)
+    {
+        message[i] = uint8_t(i * 7 + 1);
+    }
+    std::vector<uint8_t> expected = XofClass::calcXof(message.data(), message.size(), 500);
+    ASSERT_EQ(ut1::hexlify(std::vector<uint8_t>(expected.end() - 32, expected.end())), expectedTail);
+
+    for (size_t chunkSize: {1, 7, 100, 167, 168, 169, 500})
+    {
+        XofClass xof;
+        for (size_t i = 0; i < message.size(); i += chunkSize)
+        {
+            xof.update(message.data() + i, std::min(chunkSize, message.size() - i));
+        }
+        std::vector<uint8_t> output(expected.size());
+        for (size_t i = 0; i < output.size(); i += chunkSize)
+        {
+            xof.squeeze(std::span<uint8_t>(output.data() + i, std::min(chunkSize, output.size() - i)));
+        }
+        ASSERT_EQ(ut1::hexlify(output), ut1::hexlify(expected));
+    }
+}
+
+UNIT_TEST(Shake)
+{
+    // Empty message values from FIPS 202 examples, long message values from Python's hashlib.
+    testShake<Shake128>("7f9c2ba4e88f827d616045507605853ed73b8093f6efbc88eb1a6eacfa66ef26", "d94691d1b20049ff8052f1d95c1928a952b35712a53dcacc1bf3dbc5cad8878b");
+    testShake<Shake256>("46b9dd2b0ba88d13233b3feb743eeb243fcd52ea62b81b82b50c27646ed5762fd75dc4ddd8c0f200cb05019d67b592f6fc821c49479ab48640292eacb3b7c4be", "10e863112950b172f771bfb22388cbe8cda638c6524199c3b3a8f067abec6a59");
+}
+
+/// Get bytes 0, 1, ..., n - 1 (mod 256) (SP 800-185 examples).
+static std::vector<uint8_t> countingBytes(size_t n)
+{
+    std::vector<uint8_t> r(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        r[i] = uint8_t(i);
+    }
+    return r;
+}
+
+/// Get bytes of s.
+static std::span<const uint8_t> asBytes(std::string_view s)
+{
+    return std::span<const uint8_t>(reinterpret_cast<const uint8_t *>(s.data()), s.size());
+}
+
+/// Get outputLength output bytes of cSHAKE.
+template<class XofClass>
+std::string calcCShake(std::string_view functionName, std::string_view customization, const std::vector<uint8_t> &message, size_t outputLength)
+{
+    XofClass xof(functionName, asBytes(customization));
+    xof.update(message.data(), message.size());
+    std::vector<uint8_t> output(outputLength);
+    xof.squeeze(output);
+    return ut1::hexlify(output);
+}
+
+UNIT_TEST(CShake)
+{
+    using ut1::toStr;
+    // SP 800-185 examples.
+    ASSERT_EQ(calcCShake<CShake128>("", "Email Signature", countingBytes(4), 32), "c1c36925b6409a04f1b504fcbca9d82b4017277cb5ed2b2065fc1d3814d5aaf5");
+    ASSERT_EQ(calcCShake<CShake256>("", "Email Signature", countingBytes(200), 64), "07dc27b11e51fbac75bc7b3c1d983e8b4b85fb1defaf218912ac86430273091727f42b17ed1df63e8ec118f04b23633c1dfb1574c8fb55cb45da8e25afb092bb");
+
+    // cSHAKE with empty N and S is SHAKE.
+    std::vector<uint8_t> message = countingBytes(300);
+    ASSERT_EQ(calcCShake<CShake128>("", "", message, 200), ut1::hexlify(Shake128::calcXof(message.data(), message.size(), 200)));
+    ASSERT_EQ(calcCShake<CShake256>("", "", message, 200), ut1::hexlify(Shake256::calcXof(message.data(), message.size(), 200)));
+}
+
+UNIT_TEST(Kmac)
+{
+    using ut1::toStr;
+    // SP 800-185 examples.
+    std::vector<uint8_t> key(32);
+    for (size_t i = 0; i < key.size(); i++)
+    {
+        key[i] = uint8_t(0x40 + i);
+    }
+    std::vector<uint8_t> shortMessage = countingBytes(4);
+    std::vector<uint8_t> longMessage = countingBytes(200);
+    Kmac128 kmac128(key);
+    Kmac128 kmac128Tagged(key, asBytes("My Tagged Application"));
+    Kmac256 kmac256(key);
+    Kmac256 kmac256Tagged(key, asBytes("My Tagged Application"));
+    ASSERT_EQ(ut1::hexlify(kmac128.calcMac(shortMessage.data(), shortMessage.size(), 32)), "e5780b0d3ea6f7d3a429c5706aa43a00fadbd7d49628839e3187243f456ee14e");
+    ASSERT_EQ(ut1::hexlify(kmac128Tagged.calcMac(shortMessage.data(), shortMessage.size(), 32)), "3b1fba963cd8b0b59e8c1a6d71888b7143651af8ba0a7070c0979e2811324aa5");
+    ASSERT_EQ(ut1::hexlify(kmac256Tagged.calcMac(shortMessage.data(), shortMessage.size(), 64)), "20c570c31346f703c9ac36c61c03cb64c3970d0cfc787e9b79599d273a68d2f7f69d4cc3de9d104a351689f27cf6f5951f0103f33f4f24871024d9c27773a8dd");
+    ASSERT_EQ(ut1::hexlify(kmac256.calcMac(longMessage.data(), longMessage.size(), 64)), "75358cf39e41494e949707927cee0af20a3ff553904c86b08f21cc414bcfd691589d27cf5e15369cbbff8b9a4c2eb17800855d0235ff635da82533ec6b759b69");
+
+    // Streaming: The key prefix is reused for each message.
+    for (int i = 0; i < 2; i++)
+    {
+        std::vector<uint8_t> mac(32);
+        kmac128Tagged.update(shortMessage.data(), 1);
+        kmac128Tagged.update(shortMessage.data() + 1, 3);
+        kmac128Tagged.finalize(mac);
+        ASSERT_EQ(ut1::hexlify(mac), "3b1fba963cd8b0b59e8c1a6d71888b7143651af8ba0a7070c0979e2811324aa5");
+    }
+    std::vector<uint8_t> mac = kmac128.calcMac(shortMessage.data(), shortMessage.size(), 32);
+    ASSERT_EQ(kmac128.verify(shortMessage.data(), shortMessage.size(), mac, 32), true);
+    ASSERT_EQ(kmac128Tagged.verify(shortMessage.data(), shortMessage.size(), mac, 32), false);
+
+    // Empty, truncated and too short MACs are rejected.
+    ASSERT_EQ(kmac128.verify(shortMessage.data(), shortMessage.size(), {}, 32), false);
+    ASSERT_EQ(kmac128.verify(shortMessage.data(), shortMessage.size(), {}, 0), false);
+    ASSERT_EQ(kmac128.verify(shortMessage.data(), shortMessage.size(), std::span<const uint8_t>(mac.data(), 16), 32), false);
+    std::vector<uint8_t> shortMac = kmac128.calcMac(shortMessage.data(), shortMessage.size(), 1);
+    ASSERT_EQ(kmac128.verify(shortMessage.data(), shortMessage.size(), shortMac, 1), false);
+    std::vector<uint8_t> minMac = kmac128.calcMac(shortMessage.data(), shortMessage.size(), Kmac128::minMacLength);
+    ASSERT_EQ(kmac128.verify(shortMessage.data(), shortMessage.size(), minMac, Kmac128::minMacLength), true);
+
+    // XOF mode (KMACXOF128 SP 800-185 example), squeezed in two parts.
+    std::vector<uint8_t> output(32);
+    kmac128Tagged.update(shortMessage.data(), shortMessage.size());
+    kmac128Tagged.squeeze(std::span<uint8_t>(output.data(), 5));
+    kmac128Tagged.squeeze(std::span<uint8_t>(output.data() + 5, 27));
+    ASSERT_EQ(ut1::hexlify(output), "31a44527b4ed9f5c6101d11de6d26f0620aa5c341def41299657fe9df1a3b16c");
+    kmac128Tagged.clear();
+}
+
+/// Get hash (fixed length mode) of message passed to update() in chunks of chunkSize bytes.
+template<class HashClass>
+std::string calcParallelHash(HashClass &hasher, const std::vector<uint8_t> &message, size_t chunkSize, size_t hashLength)
+{
+    for (size_t i = 0; i < message.size(); i += chunkSize)
+    {
+        hasher.update(message.data() + i, std::min(chunkSize, message.size() - i));
+    }
+    std::vector<uint8_t> hash(hashLength);
+    hasher.finalize(hash);
+    return ut1::hexlify(hash);
+}
+
+UNIT_TEST(ParallelHash)
+{
+    using ut1::toStr;
+    // SP 800-185 examples (leaf size 8).
+    std::vector<uint8_t> sample(24);
+    for (size_t i = 0; i < sample.size(); i++)
+    {
+        sample[i] = uint8_t(i / 8 * 16 + i % 8);
+    }
+    ParallelHash128 sample128(8);
+    ParallelHash128 sample128Tagged(8, asBytes("Parallel Data"));
+    ParallelHash256 sample256Tagged(8, asBytes("Parallel Data"));
+    ASSERT_EQ(calcParallelHash(sample128, sample, sample.size(), 32), "ba8dc1d1d979331d3f813603c67f72609ab5e44b94a0b8f9af46514454a2b4f5");
+    ASSERT_EQ(calcParallelHash(sample128Tagged, sample, sample.size(), 32), "fc484dcb3f84dceedc353438151bee58157d6efed0445a81f165e495795b7206");
+    ASSERT_EQ(calcParallelHash(sample256Tagged, sample, sample.size(), 64), "cdf15289b54f6212b4bc270528b49526006dd9b54e2b6add1ef6900dda3963bb33a72491f236969ca8afaea29c682d47a393c065b38e29fae651a2091c833110");
+    std::vector<uint8_t> output(32);
+    sample128Tagged.update(sample.data(), sample.size());
+    sample128Tagged.squeeze(std::span<uint8_t>(output.data(), 5));
+    sample128Tagged.squeeze(std::span<uint8_t>(output.data() + 5, 27));
+    ASSERT_EQ(ut1::hexlify(output), "ea2a793140820f7a128b8eb70a9439f93257c6e6e79b4a540d291d6dae7098d7");
+
+    // Long messages (several batches, partial last leaf) with one and several threads. Values from a Python implementation on top of hashlib.shake_128/256.
+    std::vector<uint8_t> message(100000);
+    for (size_t i = 0; i < message.size(); i++)
+    {
+        message[i] = uint8_t(i * 7 + 1);
+    }
+    for (std::shared_ptr<WorkerPool> pool: {std::make_shared<WorkerPool>(1), std::make_shared<WorkerPool>(3), std::shared_ptr<WorkerPool>()})
+    {
+        ParallelHash128 hasher128(ParallelHash128::defaultLeafSize, {}, pool);
+        ParallelHash128 hasher128Tagged(1000, asBytes("x"), pool);
+        ParallelHash256 hasher256(ParallelHash256::defaultLeafSize, {}, pool);
+        ParallelHash128 tinyLeaves(8, {}, pool);
+        for (size_t chunkSize: {1000, 8191, 8192, 100000})
+        {
+            ASSERT_EQ(calcParallelHash(hasher128, message, chunkSize, 32), "28d50f3cec654d0e4d2fe0308bbc57b180717e2dcdfa3e5cf658c50a2b3d8a2d");
+            ASSERT_EQ(calcParallelHash(tinyLeaves, message, chunkSize, 32), "22c946e8a66df9b1b04eaa04354bbc73d6f2ff6ea69b816eda46e41c03060035");
+            ASSERT_EQ(calcParallelHash(hasher128Tagged, message, chunkSize, 32), "bde47532dc722f544d13fb5d0754e6712a3041b2814515285700615f6df572c9");
+            ASSERT_EQ(calcParallelHash(hasher256, message, chunkSize, 64), "382767cde575455ac45096abbc72b154ad279397511ae742ae9b1e35be8d39d347ce0ed087e09e10c06dafe7d2d44053b278553237d8681b32fed30fc8091b78");
+        }
+        ASSERT_EQ(calcParallelHash(hasher128, {}, 1, 32), "c7b32e3b071f7fb9c58054c93c2f35e0d8051a270d6c0136ef849232c96cd1c5");
+        std::vector<uint8_t> xofOutput(64);
+        hasher256.update(message.data(), message.size());
+        hasher256.squeeze(xofOutput);
+        ASSERT_EQ(ut1::hexlify(xofOutput), "f162e3a8761937a1cdbc6ea3274344d104ccae713de6dff797da0cc3ba134cb1f0f13571b9634ef006f1881311b8266a3c10c9493d0f2926eb2b491bdc9acbc3");
+    }
+
+    // Leaves larger than maxBatchSize are absorbed without buffering.
+    std::vector<uint8_t> longMessage(12000000);
+    for (size_t i = 0; i < longMessage.size(); i++)
+    {
+        longMessage[i] = uint8_t(i * 7 + 1);
+    }
+    ParallelHash128 largeLeaves(5000000);
+    for (size_t chunkSize: {1000000, 3000001, 12000000})
+    {
+        ASSERT_EQ(calcParallelHash(largeLeaves, longMessage, chunkSize, 32), "3cedd0744cfe065410966f0fe3d94123bedaced6822ab4b506fceca3f1c14400");
+    }
+}
+
+/// Check compile time evaluation against the runtime implementation.
+template<class HashClass>
+void testConstexpr()
+{
+    using ut1::toStr;
+    static constexpr const char *input = "The quick brown fox jumps over the lazy dog. The quick brown fox jumps over the lazy dog. "
+                                         "The quick brown fox jumps over the lazy dog. The quick brown fox jumps over the lazy dog.";
+    constexpr Digest<HashClass::hashSize> empty = calcDigest<HashClass>("");
+    constexpr Digest<HashClass::hashSize> digest = calcDigest<HashClass>(input);
+    ASSERT_EQ(empty.toHex(), ut1::hexlify(calcHash<HashClass>(std::string())));
+    ASSERT_EQ(digest.toHex(), ut1::hexlify(calcHash<HashClass>(std::string(input))));
+}
+
+UNIT_TEST(Constexpr)
+{
+    static_assert(calcDigest<HashSha256>("abc") == Digest<32>{{0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+                                                               0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad}});
+    testConstexpr<HashMd5>();
+    testConstexpr<HashSha1>();
+    testConstexpr<HashSha256>();
+    testConstexpr<HashSha512>();
+    testConstexpr<HashSha3_224>();
+    testConstexpr<HashSha3_256>();
+    testConstexpr<HashSha3_384>();
+    testConstexpr<HashSha3_512>();
+}
+
+/// Check that hashing can be continued from exported states at all positions in the message.
+template<class HashClass>
+void testMidstate()
+{
+    using ut1::toStr;
+    std::vector<uint8_t> message(300);
+    for (size_t i = 0; i < message.size(); i++)
+    {
+        message[i] = uint8_t(i * 29 + 3);
+    }
+    std::string expected = ut1::hexlify(calcHash<HashClass>(message));
+    for (size_t prefix = 0; prefix <= message.size(); prefix++)
+    {
+        HashClass hasher;
+        hasher.update(message.data(), prefix);
+        std::vector<uint8_t> blob = hasher.exportState();
+
+        HashClass resumed;
+        ASSERT_EQ(resumed.importState(blob), true);
+        resumed.update(message.data() + prefix, message.size() - prefix);
+        ASSERT_EQ(ut1::hexlify(resumed.finalize()), expected);
+
+        // Truncated or modified blobs are rejected.
+        ASSERT_EQ(resumed.importState(std::span<const uint8_t>(blob.data(), blob.size() - 1)), false);
+        for (size_t i: {0, 1, 2})
+        {
+            std::vector<uint8_t> bad = blob;
+            bad[i] ^= 0x40;
+            ASSERT_EQ(resumed.importState(bad), false);
+        }
+    }
+}
+
+/// Check scatter-gather hashing with fragments of various sizes.
+template<class HashClass>
+void testUpdatev()
+{
+    using ut1::toStr;
+    std::vector<uint8_t> message(500);
+    for (size_t i = 0; i < message.size(); i++)
+    {
+        message[i] = uint8_t(i * 31 + 7);
+    }
+    std::string expected = ut1::hexlify(calcHash<HashClass>(message));
+    for (size_t fragmentSize: {1, 3, 17, 55, 64, 65, 127, 128, 136, 200, 500})
+    {
+        std::vector<std::span<const uint8_t>> fragments;
+        for (size_t i = 0; i < message.size(); i += fragmentSize)
+        {
+            fragments.emplace_back(message.data() + i, std::min(fragmentSize, message.size() - i));
+        }
+        fragments.emplace_back();
+        ASSERT_EQ(ut1::hexlify(calcHash<HashClass>(fragments)), expected);
+
+        // Continue a partial block from update() and split the fragments over two updatev() calls.
+        std::vector<std::span<const uint8_t>> rest;
+        for (size_t i = 5; i < message.size(); i += fragmentSize)
+        {
+            rest.emplace_back(message.data() + i, std::min(fragmentSize, message.size() - i));
+        }
+        std::span<const std::span<const uint8_t>> restSpan(rest);
+        HashClass hasher;
+        hasher.update(message.data(), 5);
+        hasher.updatev(restSpan.first(rest.size() / 2));
+        hasher.updatev(restSpan.subspan(rest.size() / 2));
+        ASSERT_EQ(ut1::hexlify(hasher.finalize()), expected);
+    }
+    std::span<const uint8_t> single[1] = {message};
+    ASSERT_EQ(ut1::hexlify(calcHash<HashClass>(single)), expected);
+}
+
+UNIT_TEST(Updatev)
+{
+    testUpdatev<HashMd5>();
+    testUpdatev<HashSha1>();
+    testUpdatev<HashSha256>();
+    testUpdatev<HashSha512>();
+    testUpdatev<HashSha3_256>();
+}
+
+UNIT_TEST(Midstate)
+{
+    testMidstate<HashMd5>();
+    testMidstate<HashSha1>();
+    testMidstate<HashSha256>();
+    testMidstate<HashSha512>();
+    testMidstate<HashSha3_224>();
+    testMidstate<HashSha3_256>();
+    testMidstate<HashSha3_512>();
+
+    // Blobs of different algorithms with the same layout are rejected.
+    using ut1::toStr;
+    HashSha3_256 sha3;
+    HashSha3_224 other;
+    ASSERT_EQ(other.importState(sha3.exportState()), false);
+}
+
 /// Run benchmark on a specific hasher.
 template<class HashClass>
 void runBench(size_t size)
@@ -114,19 +740,43 @@ void runBench(size_t size)
     }
 }
 
-/// Run tests.
-void runTests()
+/// Run multi-buffer benchmark on a specific hasher.
+/// Hash size bytes in independent messages of 16 kB each.
+template<class HashClass>
+void runBenchMulti(size_t size)
+{
+    const size_t messageSize = 16384;
+    std::vector<std::vector<uint8_t>> messages(std::max<size_t>(size / messageSize, 1), std::vector<uint8_t>(messageSize, 'a'));
+    double start = ut1::getTimeSec();
+    std::vector<std::vector<uint8_t>> hashes = calcHashes<HashClass>(messages);
+    double elapsed = ut1::getTimeSec() - start;
+    size = messages.size() * messageSize;
+    double rate = size / elapsed;
+    std::cout << std::left << std::setw(hashNameLen) << ut1::typeName<HashClass>() << ": " << std::fixed << std::dec << std::setprecision(1) << std::setw(6) << rate / 1024.0 / 1024.0 << "MB/s (" << messages.size() << " messages of " << messageSize << " bytes in " << std::setprecision(3) << elapsed << "s, multi-buffer)\n";
+}
+
+/// Run tests and return the number of errors.
+unsigned runTests()
 {
     unsigned errors = 0;
     errors += testRefList<HashSha3_224>(refSha3_224);
+    errors += testRefListMulti<HashSha3_224>(refSha3_224);
     errors += testRefList<HashSha3_256>(refSha3_256);
+    errors += testRefListMulti<HashSha3_256>(refSha3_256);
     errors += testRefList<HashSha3_384>(refSha3_384);
+    errors += testRefListMulti<HashSha3_384>(refSha3_384);
     errors += testRefList<HashSha3_512>(refSha3_512);
+    errors += testRefListMulti<HashSha3_512>(refSha3_512);
     errors += testRefList<HashSha512>(refSha512);
+    errors += testRefListMulti<HashSha512>(refSha512);
     errors += testRefList<HashSha256>(refSha256);
+    errors += testRefListMulti<HashSha256>(refSha256);
     errors += testRefList<HashSha1>(refSha1);
+    errors += testRefListMulti<HashSha1>(refSha1);
     errors += testRefList<HashMd5>(refMd5);
+    errors += testRefListMulti<HashMd5>(refMd5);
     std::cout << std::dec << errors << " error(s) found total\n";
+    return errors;
 }
 
 /// Run benchmarks.
@@ -141,4 +791,9 @@ void runBenchmarks(size_t size)
     runBench<HashSha256>(size);
     runBench<HashSha1>(size);
     runBench<HashMd5>(size);
+    runBenchMulti<HashSha3_256>(size);
+    runBenchMulti<HashSha512>(size);
+    runBenchMulti<HashSha256>(size);
+    runBenchMulti<HashSha1>(size);
+    runBenchMulti<HashMd5>(size);
 }
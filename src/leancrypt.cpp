@@ -12,6 +12,7 @@
 #include "HashSha256.hpp"
 #include "HashSha3.hpp"
 #include "HashSha512.hpp"
+#include "Hex.hpp"
 #include "MiscUtils.hpp"
 #include "UnitTest.hpp"
 
@@ -25,7 +26,7 @@
 #include <string_view>
 #include <vector>
 
-void runTests();
+unsigned runTests();
 void runBenchmarks(size_t size);
 void setBenchVerbose(unsigned verbose);
 
@@ -174,6 +175,7 @@ int runCli(int argc, const char* argv[])
     cl.parse(argc, argv);
     setBenchVerbose(cl.getCount("verbose"));
 
+    int exitCode = 0;
     try
     {
         const std::string hashName = normalizeHashName(cl.getStr("hash"));
@@ -186,7 +188,10 @@ int runCli(int argc, const char* argv[])
         bool didWork = false;
         if (cl("test"))
         {
-            runTests();
+            if (runTests() > 0)
+            {
+                exitCode = 1;
+            }
             didWork = true;
         }
         if (cl("bench"))
@@ -204,7 +209,7 @@ int runCli(int argc, const char* argv[])
             }
             for (const auto& path: getFiles(cl.getArgs()))
             {
-                std::cout << ut1::hexlify(hasher->hashFile(path)) << "  " << path.string() << "\n";
+                std::cout << Hex::encode(hasher->hashFile(path)) << "  " << path.string() << "\n";
             }
             didWork = true;
         }
@@ -219,7 +224,7 @@ int runCli(int argc, const char* argv[])
         cl.error(e.what());
     }
 
-    return 0;
+    return exitCode;
 }
 
 #endif